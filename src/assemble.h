@@ -25,9 +25,7 @@ namespace torali
   inline void
     assemble(TConfig const& c, TValidRegion const& validRegions, std::vector<StructuralVariantRecord>& svs, TSRStore& srStore) {
     // Sequence store
-    typedef std::set<std::string> TSequences;
-    typedef std::vector<TSequences> TSVSequences;
-    TSVSequences seqStore(svs.size(), TSequences());
+    SequenceArena seqStore(svs.size());
 
     // SV consensus done
     std::vector<bool> svcons(svs.size(), false);
@@ -39,33 +37,31 @@ namespace torali
     TSamFile samfile(c.files.size());
     TIndex idx(c.files.size());
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
     }
-    bam_hdr_t* hdr = sam_hdr_read(samfile[0]);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
 
     // Parse BAM
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Split-read assembly" << std::endl;
     boost::progress_display show_progress( hdr->n_targets );
 
-    faidx_t* fai = fai_load(c.genome.string().c_str());
+    faidx_t* fai = _hFaiOpen(c.genome.string());
     for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
       ++show_progress;
       if (validRegions[refIndex].empty()) continue;
 
       // Load sequence
-      int32_t seqlen = -1;
-      std::string tname(hdr->target_name[refIndex]);
-      char* seq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr->target_len[refIndex], &seqlen);
+      RefView seq;
+      seq.load(c.genome.string(), fai, hdr->target_name[refIndex]);
     
       // Collect reads from all samples
       for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
 	// Read alignments (full chromosome because primary alignments might be somewhere else)
 	hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, 0, hdr->target_len[refIndex]);
 	bam1_t* rec = bam_init1();
-	while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
+	while (_ioItrNext(samfile[file_c], iter, rec) >= 0) {
 	  // Only primary alignments with the full sequence information
 	  if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
 
@@ -97,18 +93,17 @@ namespace torali
 		// Min. seq length and max insertion size, 10kbp?
 		if (((ePos - sPos) > window) && ((ePos - sPos) <= 10000)) {
 		  std::string seqalign = sequence.substr(sPos, (ePos - sPos));
-		  seqStore[svid].insert(seqalign);
+		  seqStore.insert(svid, seqalign);
 	      
 		  // Enough split-reads?
 		  if ((!_translocation(svs[svid].svt)) && (svs[svid].chr == refIndex)) {
-		    if ((seqStore[svid].size() == maxReadPerSV) || ((int32_t) seqStore[svid].size() == svs[svid].srSupport)) {
+		    if ((seqStore.size(svid) == maxReadPerSV) || ((int32_t) seqStore.size(svid) == svs[svid].srSupport)) {
 		      bool msaSuccess = false;
-		      if (seqStore[svid].size() > 1) {
+		      if (seqStore.size(svid) > 1) {
 			//std::cerr << svs[svid].svStart << ',' << svs[svid].svEnd << ',' << svs[svid].svt << ',' << svid << " SV" << std::endl;
-			//for(typename TSequences::iterator it = seqStore[svid].begin(); it != seqStore[svid].end(); ++it) std::cerr << *it << std::endl;
-			msa(c, seqStore[svid], svs[svid].consensus);
+			msa(c, seqStore, svid, svs[svid].consensus);
 			//std::cerr << svs[svid].consensus << std::endl;
-			if (alignConsensus(c, hdr, seq, NULL, svs[svid])) msaSuccess = true;
+			if (alignConsensus(c, hdr, &seq, NULL, svs[svid])) msaSuccess = true;
 			//std::cerr << msaSuccess << std::endl;
 		      }
 		      if (!msaSuccess) {
@@ -116,7 +111,7 @@ namespace torali
 			svs[svid].srSupport = 0;
 			svs[svid].srAlignQuality = 0;
 		      }
-		      seqStore[svid].clear();
+		      seqStore.clear(svid);
 		      svcons[svid] = true;
 		    }
 		  }
@@ -133,31 +128,24 @@ namespace torali
 	if (!svcons[svid]) {
 	  if ((!_translocation(svs[svid].svt)) && (svs[svid].chr == refIndex)) {
 	    bool msaSuccess = false;
-	    if (seqStore[svid].size() > 1) {
-	      msa(c, seqStore[svid], svs[svid].consensus);
-	      if (alignConsensus(c, hdr, seq, NULL, svs[svid])) msaSuccess = true;
+	    if (seqStore.size(svid) > 1) {
+	      msa(c, seqStore, svid, svs[svid].consensus);
+	      if (alignConsensus(c, hdr, &seq, NULL, svs[svid])) msaSuccess = true;
 	    }
 	    if (!msaSuccess) {
 	      svs[svid].consensus = "";
 	      svs[svid].srSupport = 0;
 	      svs[svid].srAlignQuality = 0;
 	    }
-	    seqStore[svid].clear();
+	    seqStore.clear(svid);
 	    svcons[svid] = true;
 	  }
 	}
       }
-      
-      // Clean-up
-      if (seq != NULL) free(seq);
     }
     // Clean-up
-    fai_destroy(fai);
-    bam_hdr_destroy(hdr);
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    _hFaiClose(fai);
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
     
     // Clean-up unfinished SVs
     for(uint32_t svid = 0; svid < svcons.size(); ++svid) {
@@ -20,39 +20,116 @@ namespace torali
 {
 
 
-  // Reduced bam alignment record data structure
+  // Reduced bam alignment record, lib is the index of the sample library
   struct BamAlignRecord {
     int32_t tid;         
     int32_t pos;
     int32_t mtid; 
     int32_t mpos;
-    int32_t alen;
-    int32_t malen;
-    int32_t Median;
-    int32_t Mad;
-    int32_t maxNormalISize;
-    uint32_t flag;
+    uint16_t alen;
+    uint16_t malen;
+    uint16_t lib;
     uint8_t MapQuality;
   
-    BamAlignRecord(bam1_t* rec, uint8_t pairQuality, uint16_t a, uint16_t ma, int32_t median, int32_t mad, int32_t maxISize) : tid(rec->core.tid), pos(rec->core.pos), mtid(rec->core.mtid), mpos(rec->core.mpos), alen(a), malen(ma), Median(median), Mad(mad), maxNormalISize(maxISize), flag(rec->core.flag), MapQuality(pairQuality) {}
+    BamAlignRecord(bam1_t* rec, uint8_t pairQuality, uint16_t a, uint16_t ma, uint16_t l) : tid(rec->core.tid), pos(rec->core.pos), mtid(rec->core.mtid), mpos(rec->core.mpos), alen(a), malen(ma), lib(l), MapQuality(pairQuality) {}
+    BamAlignRecord(int32_t const t, int32_t const p, int32_t const mt, int32_t const mp, uint8_t pairQuality, uint16_t a, uint16_t ma, uint16_t l) : tid(t), pos(p), mtid(mt), mpos(mp), alen(a), malen(ma), lib(l), MapQuality(pairQuality) {}
   };
 
+  // Columnar store of reduced bam alignment records
+  struct BamAlignStore {
+    std::vector<int32_t> tid;
+    std::vector<int32_t> pos;
+    std::vector<int32_t> mtid;
+    std::vector<int32_t> mpos;
+    std::vector<uint16_t> alen;
+    std::vector<uint16_t> malen;
+    std::vector<uint16_t> lib;
+    std::vector<uint8_t> qual;
+
+    inline std::size_t size() const { return pos.size(); }
+    inline bool empty() const { return pos.empty(); }
+
+    inline void push_back(BamAlignRecord const& r) {
+      tid.push_back(r.tid);
+      pos.push_back(r.pos);
+      mtid.push_back(r.mtid);
+      mpos.push_back(r.mpos);
+      alen.push_back(r.alen);
+      malen.push_back(r.malen);
+      lib.push_back(r.lib);
+      qual.push_back(r.MapQuality);
+    }
+
+    inline void append(BamAlignStore const& o) {
+      tid.insert(tid.end(), o.tid.begin(), o.tid.end());
+      pos.insert(pos.end(), o.pos.begin(), o.pos.end());
+      mtid.insert(mtid.end(), o.mtid.begin(), o.mtid.end());
+      mpos.insert(mpos.end(), o.mpos.begin(), o.mpos.end());
+      alen.insert(alen.end(), o.alen.begin(), o.alen.end());
+      malen.insert(malen.end(), o.malen.begin(), o.malen.end());
+      lib.insert(lib.end(), o.lib.begin(), o.lib.end());
+      qual.insert(qual.end(), o.qual.begin(), o.qual.end());
+    }
+
+    inline void swap(BamAlignStore& o) {
+      tid.swap(o.tid);
+      pos.swap(o.pos);
+      mtid.swap(o.mtid);
+      mpos.swap(o.mpos);
+      alen.swap(o.alen);
+      malen.swap(o.malen);
+      lib.swap(o.lib);
+      qual.swap(o.qual);
+    }
+  };
+
+  template<typename TValue>
+  inline void
+  _permute(std::vector<TValue>& col, std::vector<uint32_t> const& order) {
+    std::vector<TValue> sorted(order.size());
+    for(uint32_t i = 0; i < order.size(); ++i) sorted[i] = col[order[i]];
+    col.swap(sorted);
+  }
+
   // Sort reduced bam alignment records
-  template<typename TRecord>
-  struct SortBamRecords : public std::binary_function<TRecord, TRecord, bool>
+  template<typename TLibraries>
+  struct SortBamRecords : public std::binary_function<uint32_t, uint32_t, bool>
   {
-    inline bool operator()(TRecord const& s1, TRecord const& s2) const {
-      if (s1.tid==s1.mtid) {
-	return ((std::min(s1.pos, s1.mpos) < std::min(s2.pos, s2.mpos)) || 
-		((std::min(s1.pos, s1.mpos) == std::min(s2.pos, s2.mpos)) && (std::max(s1.pos, s1.mpos) < std::max(s2.pos, s2.mpos))) ||
-		((std::min(s1.pos, s1.mpos) == std::min(s2.pos, s2.mpos)) && (std::max(s1.pos, s1.mpos) == std::max(s2.pos, s2.mpos)) && (s1.maxNormalISize < s2.maxNormalISize)));
+    BamAlignStore const& br;
+    TLibraries const& lib;
+
+    SortBamRecords(BamAlignStore const& b, TLibraries const& l) : br(b), lib(l) {}
+    
+    inline bool operator()(uint32_t const i, uint32_t const j) const {
+      if (br.tid[i]==br.mtid[i]) {
+	int32_t min1 = std::min(br.pos[i], br.mpos[i]);
+	int32_t min2 = std::min(br.pos[j], br.mpos[j]);
+	int32_t max1 = std::max(br.pos[i], br.mpos[i]);
+	int32_t max2 = std::max(br.pos[j], br.mpos[j]);
+	return ((min1 < min2) || ((min1 == min2) && (max1 < max2)) || ((min1 == min2) && (max1 == max2) && (lib[br.lib[i]].maxNormalISize < lib[br.lib[j]].maxNormalISize)));
       } else {
-	return ((s1.pos < s2.pos) ||
-		((s1.pos == s2.pos) && (s1.mpos < s2.mpos)) ||
-		((s1.pos == s2.pos) && (s1.mpos == s2.mpos) && (s1.maxNormalISize < s2.maxNormalISize)));
+	return ((br.pos[i] < br.pos[j]) ||
+		((br.pos[i] == br.pos[j]) && (br.mpos[i] < br.mpos[j])) ||
+		((br.pos[i] == br.pos[j]) && (br.mpos[i] == br.mpos[j]) && (lib[br.lib[i]].maxNormalISize < lib[br.lib[j]].maxNormalISize)));
       }
     }
   };
+
+  template<typename TLibraries>
+  inline void
+  sortBamRecords(BamAlignStore& br, TLibraries const& lib) {
+    std::vector<uint32_t> order(br.size());
+    for(uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), SortBamRecords<TLibraries>(br, lib));
+    _permute(br.tid, order);
+    _permute(br.pos, order);
+    _permute(br.mtid, order);
+    _permute(br.mpos, order);
+    _permute(br.alen, order);
+    _permute(br.malen, order);
+    _permute(br.lib, order);
+    _permute(br.qual, order);
+  }
   
 
   // Edge struct
@@ -76,70 +153,78 @@ namespace torali
   };
 
   // Initialize clique, deletions
-  template<typename TBamRecord, typename TSize>
+  template<int32_t TSvt, typename TSize>
   inline void
-  _initClique(TBamRecord const& el, TSize& svStart, TSize& svEnd, TSize& wiggle, int32_t const svt) {
-    if (_translocation(svt)) {
-      uint8_t ct = _getSpanOrientation(svt);
+  _initClique(BamAlignStore const& br, std::size_t const v, int32_t const maxNormalISize, TSize& svStart, TSize& svEnd, TSize& wiggle) {
+    int32_t const pos = br.pos[v];
+    int32_t const mpos = br.mpos[v];
+    int32_t const alen = br.alen[v];
+    int32_t const malen = br.malen[v];
+    if (SvtPolicy<TSvt>::translocation) {
+      int32_t const ct = SvtPolicy<TSvt>::ct;
       if (ct%2==0) {
-	svStart = el.pos + el.alen;
-	if (ct>=2) svEnd = el.mpos;
-	else svEnd = el.mpos + el.malen;
+	svStart = pos + alen;
+	if (ct>=2) svEnd = mpos;
+	else svEnd = mpos + malen;
       } else {
-	svStart = el.pos;
-	if (ct>=2) svEnd = el.mpos + el.malen;
-	else svEnd = el.mpos;
+	svStart = pos;
+	if (ct>=2) svEnd = mpos + malen;
+	else svEnd = mpos;
       }
-      wiggle=el.maxNormalISize;
+      wiggle=maxNormalISize;
     } else {
-      if (svt == 0) {
-	svStart = el.mpos + el.malen;
-	svEnd = el.pos + el.alen;
-	wiggle = el.maxNormalISize - std::max(el.alen, el.malen);
-      } else if (svt == 1) {
-	svStart = el.mpos;
-	svEnd = el.pos;
-	wiggle = el.maxNormalISize - std::max(el.alen, el.malen);
-      } else if (svt == 2) {
-	svStart = el.mpos + el.malen;
-	svEnd = el.pos;
-	wiggle =  -el.maxNormalISize;
-      } else if (svt == 3) {
-	svStart = el.mpos;
-	svEnd = el.pos + el.alen;
-	wiggle = el.maxNormalISize;
+      if (TSvt == 0) {
+	svStart = mpos + malen;
+	svEnd = pos + alen;
+	wiggle = maxNormalISize - std::max(alen, malen);
+      } else if (TSvt == 1) {
+	svStart = mpos;
+	svEnd = pos;
+	wiggle = maxNormalISize - std::max(alen, malen);
+      } else if (TSvt == 2) {
+	svStart = mpos + malen;
+	svEnd = pos;
+	wiggle =  -maxNormalISize;
+      } else if (TSvt == 3) {
+	svStart = mpos;
+	svEnd = pos + alen;
+	wiggle = maxNormalISize;
       }
     } 
   }
 
   // Update clique, deletions
-  template<typename TBamRecord, typename TSize>
+  template<int32_t TSvt, typename TSize>
   inline bool 
-  _updateClique(TBamRecord const& el, TSize& svStart, TSize& svEnd, TSize& wiggle, int32_t const svt) 
+  _updateClique(BamAlignStore const& br, std::size_t const v, int32_t const maxNormalISize, TSize& svStart, TSize& svEnd, TSize& wiggle) 
   {
-    if (_translocation(svt)) {
-      int ct = _getSpanOrientation(svt);
+    int32_t const pos = br.pos[v];
+    int32_t const mpos = br.mpos[v];
+    int32_t const alen = br.alen[v];
+    int32_t const malen = br.malen[v];
+    if (SvtPolicy<TSvt>::translocation) {
+      int32_t const ct = SvtPolicy<TSvt>::ct;
       TSize newSvStart;
       TSize newSvEnd;
       TSize newWiggle = wiggle;
       if (ct%2==0) {
-	newSvStart = std::max(svStart, el.pos + el.alen);
+	newSvStart = std::max(svStart, pos + alen);
 	newWiggle -= (newSvStart - svStart);
 	if (ct>=2) {
-	  newSvEnd = std::min(svEnd, el.mpos);
+	  newSvEnd = std::min(svEnd, mpos);
 	  newWiggle -= (svEnd - newSvEnd);
 	} else  {
-	  newSvEnd = std::max(svEnd, el.mpos + el.malen);
+	  newSvEnd = std::max(svEnd, mpos + malen);
 	  newWiggle -= (newSvEnd - svEnd);
 	}
       } else {
-	newSvStart = std::min(svStart, el.pos);
+	newSvStart = std::min(svStart, pos);
 	newWiggle -= (svStart - newSvStart);
 	if (ct>=2) {
-	  newSvEnd = std::max(svEnd, el.mpos + el.malen);
+	  newSvEnd = std::max(svEnd, mpos + malen);
 	  newWiggle -= (newSvEnd - svEnd);
 	} else {
-	  newSvEnd = std::min(svEnd, el.mpos);
+	  newSvEnd = std::min(svEnd, mpos);
 	  newWiggle -= (svEnd - newSvEnd);
 	}
       }
@@ -152,21 +237,21 @@ namespace torali
       }
       return false;
     } else {
-      if ((svt == 0) || (svt == 1)) { 
-	int ct = _getSpanOrientation(svt);
+      if ((TSvt == 0) || (TSvt == 1)) { 
+	int32_t const ct = SvtPolicy<TSvt>::ct;
 	TSize newSvStart;
 	TSize newSvEnd;
 	TSize newWiggle;
 	TSize wiggleChange;
 	if (!ct) {
-	  newSvStart = std::max(svStart, el.mpos + el.malen);
-	  newSvEnd = std::max(svEnd, el.pos + el.alen);
-	  newWiggle = std::min(el.maxNormalISize - (newSvStart - el.mpos), el.maxNormalISize - (newSvEnd - el.pos));
+	  newSvStart = std::max(svStart, mpos + malen);
+	  newSvEnd = std::max(svEnd, pos + alen);
+	  newWiggle = std::min(maxNormalISize - (newSvStart - mpos), maxNormalISize - (newSvEnd - pos));
 	  wiggleChange = wiggle - std::max(newSvStart - svStart, newSvEnd - svEnd);
 	} else {
-	  newSvStart = std::min(svStart, el.mpos);
-	  newSvEnd = std::min(svEnd, el.pos);
-	  newWiggle = std::min(el.maxNormalISize - (el.mpos + el.malen - newSvStart), el.maxNormalISize - (el.pos + el.alen - newSvEnd));
+	  newSvStart = std::min(svStart, mpos);
+	  newSvEnd = std::min(svEnd, pos);
+	  newWiggle = std::min(maxNormalISize - (mpos + malen - newSvStart), maxNormalISize - (pos + alen - newSvEnd));
 	  wiggleChange = wiggle - std::max(svStart - newSvStart, svEnd - newSvEnd);
 	}
 	if (wiggleChange < newWiggle) newWiggle=wiggleChange;
@@ -179,10 +264,10 @@ namespace torali
 	  return true;
 	}
 	return false;
-      } else if (svt == 2) {
-	TSize newSvStart = std::max(svStart, el.mpos + el.malen);
-	TSize newSvEnd = std::min(svEnd, el.pos);
-	TSize newWiggle = el.pos + el.alen - el.mpos - el.maxNormalISize - (newSvEnd - newSvStart);
+      } else if (TSvt == 2) {
+	TSize newSvStart = std::max(svStart, mpos + malen);
+	TSize newSvEnd = std::min(svEnd, pos);
+	TSize newWiggle = pos + alen - mpos - maxNormalISize - (newSvEnd - newSvStart);
 	TSize wiggleChange = wiggle + (svEnd-svStart) - (newSvEnd - newSvStart);
 	if (wiggleChange > newWiggle) newWiggle=wiggleChange;
 	
@@ -194,10 +279,10 @@ namespace torali
 	  return true;
 	}
 	return false;
-      } else if (svt == 3) {
-	TSize newSvStart = std::min(svStart, el.mpos);
-	TSize newSvEnd = std::max(svEnd, el.pos + el.alen);
-	TSize newWiggle = el.pos - (el.mpos + el.malen) + el.maxNormalISize - (newSvEnd - newSvStart);
+      } else if (TSvt == 3) {
+	TSize newSvStart = std::min(svStart, mpos);
+	TSize newSvEnd = std::max(svEnd, pos + alen);
+	TSize newWiggle = pos - (mpos + malen) + maxNormalISize - (newSvEnd - newSvStart);
 	TSize wiggleChange = wiggle - ((newSvEnd - newSvStart) - (svEnd-svStart));
 	if (wiggleChange < newWiggle) newWiggle = wiggleChange;
 	
@@ -416,9 +501,9 @@ namespace torali
   }
 
 
-  template<typename TConfig, typename TCompEdgeList, typename TBamRecord, typename TSVs>
+  template<int32_t TSvt, typename TConfig, typename TCompEdgeList, typename TLibraries, typename TSVs>
   inline void
-  _searchCliques(TConfig const& c, TCompEdgeList& compEdge, TBamRecord const& bamRecord, TSVs& svs, int32_t const svt) {
+  _searchCliques(TConfig const& c, TCompEdgeList& compEdge, BamAlignStore const& br, TLibraries const& lib, TSVs& svs) {
     typedef typename TCompEdgeList::mapped_type TEdgeList;
     typedef typename TEdgeList::value_type TEdgeRecord;
 
@@ -437,9 +522,9 @@ namespace torali
       int32_t svStart = -1;
       int32_t svEnd = -1;
       int32_t wiggle = 0;
-      int32_t clusterRefID=bamRecord[itWEdge->source].tid;
-      int32_t clusterMateRefID=bamRecord[itWEdge->source].mtid;
-      _initClique(bamRecord[itWEdge->source], svStart, svEnd, wiggle, svt);
+      int32_t clusterRefID=br.tid[itWEdge->source];
+      int32_t clusterMateRefID=br.mtid[itWEdge->source];
+      _initClique<TSvt>(br, itWEdge->source, lib[br.lib[itWEdge->source]].maxNormalISize, svStart, svEnd, wiggle);
       if ((clusterRefID==clusterMateRefID) && (svStart >= svEnd))  continue;
       clique.insert(itWEdge->source);
       
@@ -454,14 +539,14 @@ namespace torali
 	  else if ((clique.find(itWEdge->source) != clique.end()) && (clique.find(itWEdge->target) == clique.end())) v = itWEdge->target;
 	  else continue;
 	  if (incompatible.find(v) != incompatible.end()) continue;
-	  cliqueGrow = _updateClique(bamRecord[v], svStart, svEnd, wiggle, svt);
+	  cliqueGrow = _updateClique<TSvt>(br, v, lib[br.lib[v]].maxNormalISize, svStart, svEnd, wiggle);
 	  if (cliqueGrow) clique.insert(v);
 	  else incompatible.insert(v);
 	}
       }
 
       // Enough paired-ends
-      if ((clique.size() >= c.minCliqueSize) && (_svSizeCheck(svStart, svEnd, svt))) {
+      if ((clique.size() >= c.minCliqueSize) && (_svSizeCheck(svStart, svEnd, (int32_t) TSvt))) {
 	StructuralVariantRecord svRec;
 	svRec.chr = clusterRefID;
 	svRec.chr2 = clusterMateRefID;
@@ -476,15 +561,15 @@ namespace torali
 	svRec.mapq = 0;
 	std::vector<uint8_t> mapQV;
 	for(typename TCliqueMembers::const_iterator itC = clique.begin(); itC!=clique.end(); ++itC) {
-	  mapQV.push_back(bamRecord[*itC].MapQuality);
-	  svRec.mapq += bamRecord[*itC].MapQuality;
+	  mapQV.push_back(br.qual[*itC]);
+	  svRec.mapq += br.qual[*itC];
 	}
 	std::sort(mapQV.begin(), mapQV.end());
 	svRec.peMapQuality = mapQV[mapQV.size()/2];
 	svRec.srSupport=0;
 	svRec.srAlignQuality=0;
 	svRec.precise=false;
-	svRec.svt = svt;
+	svRec.svt = TSvt;
 	svRec.insLen = 0;
 	svRec.homLen = 0;
 	svs.push_back(svRec);
@@ -494,14 +579,13 @@ namespace torali
   
   
 
-  template<typename TConfig>
+  template<int32_t TSvt, typename TConfig, typename TLibraries>
   inline void
-  cluster(TConfig const& c, std::vector<BamAlignRecord>& bamRecord, std::vector<StructuralVariantRecord>& svs, uint32_t const varisize, int32_t const svt) {
-    typedef typename std::vector<BamAlignRecord> TBamRecord;
+  _cluster(TConfig const& c, BamAlignStore const& br, TLibraries const& lib, std::vector<StructuralVariantRecord>& svs, uint32_t const varisize) {
     // Components
     typedef std::vector<uint32_t> TComponent;
     TComponent comp;
-    comp.resize(bamRecord.size(), 0);
+    comp.resize(br.size(), 0);
     uint32_t numComp = 0;
       
     // Edge lists for each component
@@ -515,64 +599,62 @@ namespace torali
     // Iterate the chromosome range
     std::size_t lastConnectedNode = 0;
     std::size_t lastConnectedNodeStart = 0;
-    std::size_t bamItIndex = 0;
-    for(TBamRecord::const_iterator bamIt = bamRecord.begin(); bamIt != bamRecord.end(); ++bamIt, ++bamItIndex) {
+    for(std::size_t i = 0; i < br.size(); ++i) {
       // Safe to clean the graph?
-      if (bamItIndex > lastConnectedNode) {
+      if (i > lastConnectedNode) {
 	// Clean edge lists
 	if (!compEdge.empty()) {
-	  _searchCliques(c, compEdge, bamRecord, svs, svt);
+	  _searchCliques<TSvt>(c, compEdge, br, lib, svs);
 	  lastConnectedNodeStart = lastConnectedNode;
 	  compEdge.clear();
 	}
       }
-      int32_t const minCoord = _minCoord(bamIt->pos, bamIt->mpos, svt);
-      int32_t const maxCoord = _maxCoord(bamIt->pos, bamIt->mpos, svt);
-      TBamRecord::const_iterator bamItNext = bamIt;
-      ++bamItNext;
-      std::size_t bamItIndexNext = bamItIndex + 1;
-      for(; ((bamItNext != bamRecord.end()) && ((uint32_t) std::abs(_minCoord(bamItNext->pos, bamItNext->mpos, svt) + bamItNext->alen - minCoord) <= varisize)) ; ++bamItNext, ++bamItIndexNext) {
-	  // Check that mate chr agree (only for translocations)
-	if (bamIt->mtid != bamItNext->mtid) continue;
+      int32_t const minCoord = _minCoord<TSvt>(br.pos[i], br.mpos[i]);
+      int32_t const maxCoord = _maxCoord<TSvt>(br.pos[i], br.mpos[i]);
+      int32_t const alen = br.alen[i];
+      int32_t const maxNormalISize = lib[br.lib[i]].maxNormalISize;
+      for(std::size_t j = i + 1; ((j < br.size()) && ((uint32_t) std::abs(_minCoord<TSvt>(br.pos[j], br.mpos[j]) + br.alen[j] - minCoord) <= varisize)); ++j) {
+	// Check that mate chr agree (only for translocations)
+	if (br.mtid[i] != br.mtid[j]) continue;
 	
 	// Check combinability of pairs
-	if (_pairsDisagree(minCoord, maxCoord, bamIt->alen, bamIt->maxNormalISize, _minCoord(bamItNext->pos, bamItNext->mpos, svt), _maxCoord(bamItNext->pos, bamItNext->mpos, svt), bamItNext->alen, bamItNext->maxNormalISize, svt)) continue;
+	if (_pairsDisagree<TSvt>(minCoord, maxCoord, alen, maxNormalISize, _minCoord<TSvt>(br.pos[j], br.mpos[j]), _maxCoord<TSvt>(br.pos[j], br.mpos[j]), (int32_t) br.alen[j], lib[br.lib[j]].maxNormalISize)) continue;
 	
 	// Update last connected node
-	if (bamItIndexNext > lastConnectedNode ) lastConnectedNode = bamItIndexNext;
+	if (j > lastConnectedNode ) lastConnectedNode = j;
 	
 	// Assign components
 	uint32_t compIndex = 0;
-	if (!comp[bamItIndex]) {
-	  if (!comp[bamItIndexNext]) {
+	if (!comp[i]) {
+	  if (!comp[j]) {
 	    // Both vertices have no component
 	    compIndex = ++numComp;
-	    comp[bamItIndex] = compIndex;
-	    comp[bamItIndexNext] = compIndex;
+	    comp[i] = compIndex;
+	    comp[j] = compIndex;
 	    compEdge.insert(std::make_pair(compIndex, TEdgeList()));
 	  } else {
-	    compIndex = comp[bamItIndexNext];
-	    comp[bamItIndex] = compIndex;
+	    compIndex = comp[j];
+	    comp[i] = compIndex;
 	  }
 	} else {
-	  if (!comp[bamItIndexNext]) {
-	    compIndex = comp[bamItIndex];
-	    comp[bamItIndexNext] = compIndex;
+	  if (!comp[j]) {
+	    compIndex = comp[i];
+	    comp[j] = compIndex;
 	  } else {
 	    // Both vertices have a component
-	    if (comp[bamItIndexNext] == comp[bamItIndex]) {
-	      compIndex = comp[bamItIndexNext];
+	    if (comp[j] == comp[i]) {
+	      compIndex = comp[j];
 	    } else {
 	      // Merge components
-	      compIndex = comp[bamItIndex];
-	      uint32_t otherIndex = comp[bamItIndexNext];
+	      compIndex = comp[i];
+	      uint32_t otherIndex = comp[j];
 	      if (otherIndex < compIndex) {
-		compIndex = comp[bamItIndexNext];
-		otherIndex = comp[bamItIndex];
+		compIndex = comp[j];
+		otherIndex = comp[i];
 	      }
 	      // Re-label other index
-	      for(std::size_t i = lastConnectedNodeStart; i <= lastConnectedNode; ++i) {
-		if (otherIndex == comp[i]) comp[i] = compIndex;
+	      for(std::size_t k = lastConnectedNodeStart; k <= lastConnectedNode; ++k) {
+		if (otherIndex == comp[k]) comp[k] = compIndex;
 	      }
 	      // Merge edge lists
 	      TCompEdgeList::iterator compEdgeIt = compEdge.find(compIndex);
@@ -586,19 +668,36 @@ namespace torali
 	// Append new edge
 	TCompEdgeList::iterator compEdgeIt = compEdge.find(compIndex);
 	if (compEdgeIt->second.size() < c.graphPruning) {
-	  TWeightType weight = (TWeightType) ( std::log((double) abs( abs( (_minCoord(bamItNext->pos, bamItNext->mpos, svt) - minCoord) - (_maxCoord(bamItNext->pos, bamItNext->mpos, svt) - maxCoord) ) - abs(bamIt->Median - bamItNext->Median)) + 1) / std::log(2) );
-	  compEdgeIt->second.push_back(TEdgeRecord(bamItIndex, bamItIndexNext, weight));
+	  TWeightType weight = (TWeightType) ( std::log((double) abs( abs( (_minCoord<TSvt>(br.pos[j], br.mpos[j]) - minCoord) - (_maxCoord<TSvt>(br.pos[j], br.mpos[j]) - maxCoord) ) - abs(lib[br.lib[i]].median - lib[br.lib[j]].median)) + 1) / std::log(2) );
+	  compEdgeIt->second.push_back(TEdgeRecord(i, j, weight));
 	}
       }
     }
     if (!compEdge.empty()) {
-      _searchCliques(c, compEdge, bamRecord, svs, svt);
+      _searchCliques<TSvt>(c, compEdge, br, lib, svs);
       compEdge.clear();
     }
   }
-  
 
-    
+  // Paired-end clustering, one kernel instantiation per SV type
+  template<typename TConfig, typename TLibraries>
+  inline void
+  cluster(TConfig const& c, BamAlignStore const& br, TLibraries const& lib, std::vector<StructuralVariantRecord>& svs, uint32_t const varisize, int32_t const svt) {
+    switch(svt) {
+    case 0: _cluster<0>(c, br, lib, svs, varisize); break;
+    case 1: _cluster<1>(c, br, lib, svs, varisize); break;
+    case 2: _cluster<2>(c, br, lib, svs, varisize); break;
+    case 3: _cluster<3>(c, br, lib, svs, varisize); break;
+    case 4: _cluster<4>(c, br, lib, svs, varisize); break;
+    case DELLY_SVT_TRANS + 0: _cluster<DELLY_SVT_TRANS + 0>(c, br, lib, svs, varisize); break;
+    case DELLY_SVT_TRANS + 1: _cluster<DELLY_SVT_TRANS + 1>(c, br, lib, svs, varisize); break;
+    case DELLY_SVT_TRANS + 2: _cluster<DELLY_SVT_TRANS + 2>(c, br, lib, svs, varisize); break;
+    case DELLY_SVT_TRANS + 3: _cluster<DELLY_SVT_TRANS + 3>(c, br, lib, svs, varisize); break;
+    default: break;
+    }
+  }
+
+
 }
 
 #endif
@@ -66,10 +66,9 @@ namespace torali
   inline int32_t
   bamCount(TConfig const& c, LibraryInfo const& li, std::vector<GcBias> const& gcbias, std::pair<uint32_t, uint32_t> const& gcbound) {
     // Load bam file
-    samFile* samfile = sam_open(c.bamFile.string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    hts_idx_t* idx = sam_index_load(samfile, c.bamFile.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    samFile* samfile = _hOpen(c.bamFile.string(), c.genome.string(), DELLY_CRAM_COVERAGE);
+    hts_idx_t* idx = _hIndex(samfile);
+    bam_hdr_t* hdr = _hHeader(c.bamFile.string());
 
     // BED regions
     typedef std::set<std::pair<uint32_t, uint32_t> > TChrIntervals;
@@ -100,8 +99,8 @@ namespace torali
     }
     
     // Iterate chromosomes
-    faidx_t* faiMap = fai_load(c.mapFile.string().c_str());
-    faidx_t* faiRef = fai_load(c.genome.string().c_str());
+    faidx_t* faiMap = _hFaiOpen(c.mapFile.string());
+    faidx_t* faiRef = _hFaiOpen(c.genome.string());
     for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
       ++show_progress;
       if (chrNoData(c, refIndex, idx)) continue;
@@ -117,7 +116,7 @@ namespace torali
       seqlen = faidx_seq_len(faiRef, tname.c_str());
       if (seqlen == - 1) continue;
       else seqlen = -1;
-      char* ref = faidx_fetch_seq(faiRef, tname.c_str(), 0, faidx_seq_len(faiRef, tname.c_str()), &seqlen);
+      char* ref = _refFetch(c.genome.string(), faiRef, tname.c_str(), 0, faidx_seq_len(faiRef, tname.c_str()), &seqlen);
 
       // Get GC and Mappability
       std::vector<uint16_t> uniqContent(hdr->target_len[refIndex], 0);
@@ -166,7 +165,7 @@ namespace torali
 
       {
 	// Mate map
-	typedef boost::unordered_map<std::size_t, bool> TMateMap;
+	typedef MateTable<bool> TMateMap;
 	TMateMap mateMap;
 	
 	// Count reads
@@ -174,7 +173,7 @@ namespace torali
 	bam1_t* rec = bam_init1();
 	int32_t lastAlignedPos = 0;
 	std::set<std::size_t> lastAlignedPosReads;
-	while (sam_itr_next(samfile, iter, rec) >= 0) {
+	for(RecordPrefetch prefetch(samfile, iter); prefetch.next(rec) >= 0;) {
 	  if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
 	  if (rec->core.qual < c.minQual) continue;	  
 	  if ((rec->core.flag & BAM_FPAIRED) && ((rec->core.flag & BAM_FMUNMAP) || (rec->core.tid != rec->core.mtid))) continue;
@@ -191,13 +190,13 @@ namespace torali
 	      // First read
 	      lastAlignedPosReads.insert(hash_string(bam_get_qname(rec)));
 	      std::size_t hv = hash_pair(rec);
-	      mateMap[hv] = true;
+	      mateMap.insert(hv, true);
 	      continue;
 	    } else {
 	      // Second read
 	      std::size_t hv = hash_pair_mate(rec);
-	      if ((mateMap.find(hv) == mateMap.end()) || (!mateMap[hv])) continue; // Mate discarded
-	      mateMap[hv] = false;
+	      bool mate = false;
+	      if (!mateMap.take(hv, mate)) continue; // Mate discarded
 	    }
 	    
 	    // update midpoint
@@ -445,11 +444,9 @@ namespace torali
     }
 
     // clean-up
-    fai_destroy(faiRef);
-    fai_destroy(faiMap);
-    bam_hdr_destroy(hdr);
-    hts_idx_destroy(idx);
-    sam_close(samfile);
+    _hFaiClose(faiRef);
+    _hFaiClose(faiMap);
+    _hClose(samfile);
     dataOut.pop();
     dataOut.pop();
     if (c.hasPanelFile) {
@@ -465,9 +462,15 @@ namespace torali
     CountDNAConfig c;
 
     // Parameter
+    int32_t ioThreads = 0;
+    int32_t maxOpen = 0;
+    int32_t prefetch = 0;
     boost::program_options::options_description generic("Generic options");
     generic.add_options()
       ("help,?", "show help message")
+      ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
+      ("prefetch", boost::program_options::value<int32_t>(&prefetch)->default_value(4), "record batches decoded ahead of each scan (0: off)")
+      ("max-open", boost::program_options::value<int32_t>(&maxOpen)->default_value(DELLY_MAX_OPEN), "max. open alignment files, idle files beyond are closed")
       ("genome,g", boost::program_options::value<boost::filesystem::path>(&c.genome), "genome file")
       ("quality,q", boost::program_options::value<uint16_t>(&c.minQual)->default_value(10), "min. mapping quality")
       ("mappability,m", boost::program_options::value<boost::filesystem::path>(&c.mapFile), "input mappability map")
@@ -524,6 +527,11 @@ namespace torali
       return 1;
     }
 
+    // Shared I/O thread pool and alignment handles
+    _ioPoolInit(ioThreads);
+    _ioPrefetchInit(prefetch);
+    _hPoolInit(maxOpen);
+
     // Show cmd
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
@@ -573,19 +581,20 @@ namespace torali
       TRegionsGenome scanRegions;
 
       // Open BAM file
-      samFile* samfile = sam_open(c.bamFile.string().c_str(), "r");
+      samFile* samfile = _hOpen(c.bamFile.string(), c.genome.string(), 0);
       if (samfile == NULL) {
 	std::cerr << "Fail to open file " << c.bamFile.string() << std::endl;
 	return 1;
       }
-      hts_idx_t* idx = sam_index_load(samfile, c.bamFile.string().c_str());
+      hts_idx_t* idx = _hIndex(samfile);
+      _hClose(samfile);
       if (idx == NULL) {
 	if (bam_index_build(c.bamFile.string().c_str(), 0) != 0) {
 	  std::cerr << "Fail to open index for " << c.bamFile.string() << std::endl;
 	  return 1;
 	}
       }
-      bam_hdr_t* hdr = sam_hdr_read(samfile);
+      bam_hdr_t* hdr = _hHeader(c.bamFile.string());
       if (hdr == NULL) {
 	std::cerr << "Fail to open header for " << c.bamFile.string() << std::endl;
 	return 1;
@@ -597,8 +606,8 @@ namespace torali
       c.sampleName = sampleName;
 
       // Check matching chromosome names
-      faidx_t* faiRef = fai_load(c.genome.string().c_str());
-      faidx_t* faiMap = fai_load(c.mapFile.string().c_str());
+      faidx_t* faiRef = _hFaiOpen(c.genome.string());
+      faidx_t* faiMap = _hFaiOpen(c.mapFile.string());
       uint32_t mapFound = 0;
       uint32_t refFound = 0;
       for(int32_t refIndex=0; refIndex < hdr->n_targets; ++refIndex) {
@@ -609,8 +618,8 @@ namespace torali
 	  std::cerr << "Warning: BAM chromosome " << tname << " not present in reference genome!" << std::endl;
 	}
       }
-      fai_destroy(faiRef);
-      fai_destroy(faiMap);
+      _hFaiClose(faiRef);
+      _hFaiClose(faiMap);
       if (!mapFound) {
 	std::cerr << "Mappability map chromosome naming disagrees with BAM file!" << std::endl;
 	return 1;
@@ -648,11 +657,6 @@ namespace torali
 	li.maxNormalISize = 400;
       }
       c.meanisize = ((int32_t) (li.median / 2)) * 2 + 1;
-      
-      // Clean-up
-      bam_hdr_destroy(hdr);
-      hts_idx_destroy(idx);
-      sam_close(samfile);
     }
 
     // GC bias estimation
@@ -683,16 +687,13 @@ namespace torali
 	statsOut << "LP\t" << li.rs << ',' << li.median << ',' << li.mad << ',' << li.minNormalISize << ',' << li.maxNormalISize << std::endl;
 	
 	// Scan window summry
-	samFile* samfile = sam_open(c.bamFile.string().c_str(), "r");
-	bam_hdr_t* hdr = sam_hdr_read(samfile);
+	bam_hdr_t* hdr = _hHeader(c.bamFile.string());
 	statsOut << "SW\tchrom\tstart\tend\tselected\tcoverage\tuniqcov" <<  std::endl;
 	for(uint32_t refIndex = 0; refIndex < (uint32_t) hdr->n_targets; ++refIndex) {
 	  for(uint32_t i = 0; i < scanCounts[refIndex].size(); ++i) {
 	    statsOut << "SW\t" <<  hdr->target_name[refIndex] << '\t' << scanCounts[refIndex][i].start << '\t' << scanCounts[refIndex][i].end << '\t' << scanCounts[refIndex][i].select << '\t' << scanCounts[refIndex][i].cov << '\t' << scanCounts[refIndex][i].uniqcov << std::endl;
 	  }
 	}
-	bam_hdr_destroy(hdr);
-	sam_close(samfile);
 	
 	// GC bias summary
 	statsOut << "GC\tgcsum\tsample\treference\tpercentileSample\tpercentileReference\tfractionSample\tfractionReference\tobsexp\tmeancoverage" << std::endl;
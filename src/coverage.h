@@ -153,10 +153,10 @@ namespace torali {
     boost::progress_display show_progresss( hdr->n_targets );
 
     TProbes refProbes(svs.size());
-    faidx_t* fai = fai_load(c.genome.string().c_str());
+    faidx_t* fai = _hFaiOpen(c.genome.string());
     for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
       ++show_progresss;
-      char* seq = NULL;
+      RefView seq;
 
       // Iterate all structural variants
       for(typename TSVs::iterator itSV = svs.begin(); itSV != svs.end(); ++itSV) {
@@ -164,15 +164,11 @@ namespace torali {
 	svOnChr[refIndex] = true;
 	
 	// Lazy loading of reference sequence
-	if (seq == NULL) {
-	  int32_t seqlen = -1;
-	  std::string tname(hdr->target_name[refIndex]);
-	  seq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr->target_len[refIndex], &seqlen);
-	}
+	if (!seq.loaded()) seq.load(c.genome.string(), fai, hdr->target_name[refIndex]);
 
 	// Set tag alleles
 	if (itSV->chr == refIndex) {
-	  itSV->alleles = _addAlleles(boost::to_upper_copy(std::string(seq + itSV->svStart - 1, seq + itSV->svStart)), std::string(hdr->target_name[itSV->chr2]), *itSV, itSV->svt);
+	  itSV->alleles = _addAlleles(boost::to_upper_copy(seq.slice(itSV->svStart - 1, itSV->svStart)), std::string(hdr->target_name[itSV->chr2]), *itSV, itSV->svt);
 	}
 	if (!itSV->precise) continue;
 
@@ -180,7 +176,7 @@ namespace torali {
 	if ((itSV->chr != itSV->chr2) && (itSV->chr2 == refIndex)) {
 	  Breakpoint bp(*itSV);
 	  _initBreakpoint(hdr, bp, (int32_t) itSV->consensus.size(), itSV->svt);
-	  refProbes[itSV->id] = _getSVRef(seq, bp, refIndex, itSV->svt);
+	  refProbes[itSV->id] = _getSVRef(&seq, bp, refIndex, itSV->svt);
 	}
 	if (itSV->chr == refIndex) {
 	  Breakpoint bp(*itSV);
@@ -189,7 +185,7 @@ namespace torali {
 	    int32_t bufferSpace = std::max((int32_t) ((itSV->consensus.size() - itSV->insLen) / 3), c.minimumFlankSize);
 	    _initBreakpoint(hdr, bp, bufferSpace, itSV->svt);
 	  } else _initBreakpoint(hdr, bp, (int32_t) itSV->consensus.size(), itSV->svt);
-	  std::string svRefStr = _getSVRef(seq, bp, refIndex, itSV->svt);
+	  std::string svRefStr = _getSVRef(&seq, bp, refIndex, itSV->svt);
 	  
 	  // Find breakpoint to reference
 	  typedef boost::multi_array<char, 2> TAlign;
@@ -235,16 +231,95 @@ namespace torali {
 	  }
 	}
       }
-      if (seq != NULL) free(seq);
+      seq.release();
     }
     // Clean-up
-    fai_destroy(fai);
+    _hFaiClose(fai);
     for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
       // Sort breakpoint regions
       std::sort(bpRegion[refIndex].begin(), bpRegion[refIndex].end(), SortBp<BpRegion>());
     }
   }
 
+  // Coverage of the genotyping windows of one chromosome, bases outside the windows are not stored
+  template<typename TCount>
+  struct WindowCoverage {
+    std::vector<int32_t> wbeg;
+    std::vector<int32_t> wend;
+    std::vector<uint32_t> woff;
+    std::vector<TCount> cov;
+
+    template<typename TChrIntervals>
+    explicit WindowCoverage(TChrIntervals const& chrIntervals) {
+      uint32_t off = 0;
+      for(typename TChrIntervals::const_iterator it = chrIntervals.begin(); it != chrIntervals.end(); ++it) {
+	wbeg.push_back(it->lower());
+	wend.push_back(it->upper());
+	woff.push_back(off);
+	off += it->upper() - it->lower();
+      }
+      cov.resize(off, 0);
+    }
+
+    // Window holding pos or the next window
+    inline uint32_t
+    window(int32_t const pos) const {
+      return std::upper_bound(wend.begin(), wend.end(), pos) - wend.begin();
+    }
+
+    // Increment pos, w is a window at or before pos and is advanced for increasing positions
+    inline void
+    increment(uint32_t& w, int32_t const pos, uint32_t const maxCount) {
+      while ((w < wend.size()) && (wend[w] <= pos)) ++w;
+      if ((w < wend.size()) && (wbeg[w] <= pos)) {
+	TCount& count = cov[woff[w] + pos - wbeg[w]];
+	if (count < maxCount - 1) ++count;
+      }
+    }
+
+    inline int32_t
+    sum(int32_t const beg, int32_t const end) const {
+      int32_t covbase = 0;
+      for(uint32_t w = window(beg); ((w < wbeg.size()) && (wbeg[w] < end)); ++w) {
+	int32_t wstart = std::max(beg, wbeg[w]);
+	int32_t wstop = std::min(end, wend[w]);
+	for(int32_t k = wstart; k < wstop; ++k) covbase += cov[woff[w] + k - wbeg[w]];
+      }
+      return covbase;
+    }
+  };
+
+  // Read-depth windows, breakpoints and probes of all SVs padded by the max. insert size, so that both mates of a pair near an SV are read
+  template<typename TSampleLibrary, typename TSVs, typename TGenomicBpRegion, typename TGenomicRegions>
+  inline void
+  _genotypingRegions(bam_hdr_t const* hdr, TSampleLibrary const& sampleLib, TSVs const& svs, TGenomicBpRegion const& bpRegion, TGenomicRegions& regions) {
+    typedef typename TGenomicRegions::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
+    int32_t pad = 0;
+    for(uint32_t i = 0; i < sampleLib.size(); ++i) pad = std::max(pad, sampleLib[i].maxISizeCutoff + sampleLib[i].rs);
+    typedef std::vector<std::pair<int32_t, int32_t> > TWindows;
+    std::vector<TWindows> windows(hdr->n_targets);
+    for(typename TSVs::const_iterator itSV = svs.begin(); itSV != svs.end(); ++itSV) {
+      if ((_translocation(itSV->svt)) || (itSV->svt == 4)) windows[itSV->chr].push_back(std::make_pair(itSV->svStart - 500, itSV->svStart + 500));
+      else {
+	int32_t halfSize = (itSV->svEnd - itSV->svStart) / 2;
+	windows[itSV->chr].push_back(std::make_pair(itSV->svStart - halfSize, itSV->svEnd + halfSize));
+      }
+      windows[itSV->chr2].push_back(std::make_pair(itSV->svEnd, itSV->svEnd + 1));
+    }
+    regions.clear();
+    regions.resize(hdr->n_targets);
+    for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+      for(uint32_t i = 0; i < bpRegion[refIndex].size(); ++i) windows[refIndex].push_back(std::make_pair(bpRegion[refIndex][i].regionStart, bpRegion[refIndex][i].regionEnd));
+      int32_t reflen = hdr->target_len[refIndex];
+      for(uint32_t i = 0; i < windows[refIndex].size(); ++i) {
+	int32_t wstart = std::max(0, windows[refIndex][i].first - pad);
+	int32_t wend = std::min(reflen, windows[refIndex][i].second + pad);
+	if (wstart < wend) regions[refIndex].insert(TIVal::right_open(wstart, wend));
+      }
+    }
+  }
+
   template<typename TConfig, typename TSampleLibrary, typename TSVs, typename TCoverageCount, typename TCountMap, typename TSpanMap>
   inline void
   annotateCoverage(TConfig& c, TSampleLibrary& sampleLib, TSVs& svs, TCoverageCount& covCount, TCountMap& countMap, TSpanMap& spanMap)
@@ -263,10 +338,9 @@ namespace torali {
     THeader hdr(c.files.size());
     int32_t totalTarget = 0;
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
-      hdr[file_c] = sam_hdr_read(samfile[file_c]);
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
+      hdr[file_c] = _hHeader(c.files[file_c].string());
       totalTarget += hdr[file_c]->n_targets;
     }
 
@@ -296,6 +370,19 @@ namespace torali {
     
     // Generate probes
     _generateProbes(c, hdr[0], svs, refProbeArr, consProbeArr, bpRegion, svOnChr);
+
+    // Sharded runs only read the neighbourhood of their SVs
+    typedef boost::icl::interval_set<uint32_t> TChrIntervals;
+    typedef std::vector<TChrIntervals> TGenomicRegions;
+    TGenomicRegions chrRegions(hdr[0]->n_targets);
+    for(int32_t refIndex = 0; refIndex < hdr[0]->n_targets; ++refIndex) {
+      if (hdr[0]->target_len[refIndex]) chrRegions[refIndex].insert(TChrIntervals::interval_type::right_open(0, hdr[0]->target_len[refIndex]));
+    }
+    if (c.hasRegion) _genotypingRegions(hdr[0], sampleLib, svs, bpRegion, chrRegions);
+
+    // Control samples only contribute genotypes, they are read in the neighbourhood of the SVs as well
+    TGenomicRegions ctrlRegions(chrRegions);
+    if ((!c.hasRegion) && (std::find(c.controlFile.begin(), c.controlFile.end(), true) != c.controlFile.end())) _genotypingRegions(hdr[0], sampleLib, svs, bpRegion, ctrlRegions);
   
     // Debug
     //for(uint32_t k = 0; k < 2; ++k) {
@@ -327,15 +414,20 @@ namespace torali {
       dumpOut << "#svid\tbam\tqname\tchr\tpos\tmatechr\tmatepos\tmapq\ttype" << std::endl;
     }
 
+    // Per-sample output buffers, each sample is owned by a single thread
+    std::vector<std::string> dumpStore(c.files.size());
+    std::vector<uint8_t> haplotagged(c.files.size(), 0);
+
 #pragma omp parallel for default(shared)
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      // Pair qualities and features
-      typedef boost::unordered_map<std::size_t, uint8_t> TQualities;
-      TQualities qualities;
-      TQualities qualitiestra;
-      typedef boost::unordered_map<std::size_t, bool> TClip;
-      TClip clip;
-      TClip cliptra;
+      std::ostringstream dumpBuffer;
+      bool hasHaplotags = false;
+
+      // Pair qualities and soft-clip features
+      typedef std::pair<uint8_t, bool> TQualClip;
+      typedef MateTable<TQualClip> TMateTable;
+      TMateTable mates;
+      TMateTable matestra;
       
       // Iterate chromosomes
       for(int32_t refIndex=0; refIndex < (int32_t) hdr[file_c]->n_targets; ++refIndex) {
@@ -358,9 +450,11 @@ namespace torali {
 	// Coverage track
 	typedef uint16_t TCount;
 	uint32_t maxCoverage = std::numeric_limits<TCount>::max();
-	typedef std::vector<TCount> TCoverage;
-	TCoverage covFragment(hdr[file_c]->target_len[refIndex], 0);
-	TCoverage covBases(hdr[file_c]->target_len[refIndex], 0);
+	TChrIntervals const& regions = c.controlFile[file_c] ? ctrlRegions[refIndex] : chrRegions[refIndex];
+	if (regions.empty()) continue;
+	typedef WindowCoverage<TCount> TCoverage;
+	TCoverage covFragment(regions);
+	TCoverage covBases(regions);
 	
 	// Flag breakpoint regions
 	typedef boost::dynamic_bitset<> TBitSet;
@@ -390,22 +484,27 @@ namespace torali {
 	std::sort(spanPoint.begin(), spanPoint.end(), SortBp<SpanPoint>());
       
 	// Count reads
-	hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, 0, hdr[file_c]->target_len[refIndex]);
+	hts_itr_t* iter = _validRegionsIter(idx[file_c], hdr[file_c], refIndex, regions, 0, hdr[file_c]->target_len[refIndex]);
+	if (iter == NULL) continue;
+	ValidRegionCursor<TChrIntervals> cursor(regions);
 	bam1_t* rec = bam_init1();
 	int32_t lastAlignedPos = 0;
 	std::set<std::size_t> lastAlignedPosReads;
-	while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
+	for(RecordPrefetch prefetch(samfile[file_c], iter); prefetch.next(rec) >= 0;) {
 	  if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP | BAM_FMUNMAP)) continue;
 	  if (rec->core.qual < c.minGenoQual) continue;
+	  // Nearby windows share one iterator region, skip reads in between
+	  if (cursor.anchor(rec) < 0) continue;
 	  
 	  // Count aligned basepair (small InDels)
 	  {
 	    uint32_t rp = 0; // reference pointer
+	    uint32_t w = covBases.window(rec->core.pos);
 	    uint32_t* cigar = bam_get_cigar(rec);
 	    for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
 	      if (bam_cigar_op(cigar[i]) == BAM_CMATCH) {
 		for(std::size_t k = 0; k<bam_cigar_oplen(cigar[i]);++k) {
-		  if ((rec->core.pos + rp < hdr[file_c]->target_len[refIndex]) && (covBases[rec->core.pos + rp] < maxCoverage - 1)) ++covBases[rec->core.pos + rp];
+		  covBases.increment(w, rec->core.pos + rp, maxCoverage);
 		  ++rp;
 		}
 	      } else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
@@ -494,15 +593,12 @@ namespace torali {
 			uint32_t rq = _getAlignmentQual(alignRef, quality);
 			if (rq >= c.minGenoQual) {
 			  uint8_t* hpptr = bam_aux_get(rec, "HP");
-#pragma omp critical
-			  {
-			    countMap[file_c][itBp->id].ref.push_back((uint8_t) std::min(rq, (uint32_t) rec->core.qual));
-			    if (hpptr) {
-			      c.isHaplotagged = true;
-			      int hap = bam_aux2i(hpptr);
-			      if (hap == 1) ++countMap[file_c][itBp->id].refh1;
-			      else ++countMap[file_c][itBp->id].refh2;
-			    }
+			  countMap[file_c][itBp->id].ref.push_back((uint8_t) std::min(rq, (uint32_t) rec->core.qual));
+			  if (hpptr) {
+			    hasHaplotags = true;
+			    int hap = bam_aux2i(hpptr);
+			    if (hap == 1) ++countMap[file_c][itBp->id].refh1;
+			    else ++countMap[file_c][itBp->id].refh2;
 			  }
 			}
 		      }
@@ -514,22 +610,19 @@ namespace torali {
 		      uint32_t aq = _getAlignmentQual(alignAlt, quality);
 		      if (aq >= c.minGenoQual) {
 			uint8_t* hpptr = bam_aux_get(rec, "HP");
-#pragma omp critical
-			{
-			  if (c.hasDumpFile) {
-			    std::string svid(_addID(itBp->svt));
-			    std::string padNumber = boost::lexical_cast<std::string>(itBp->id);
-			    padNumber.insert(padNumber.begin(), 8 - padNumber.length(), '0');
-			    svid += padNumber;
-			    dumpOut << svid << "\t" << c.files[file_c].string() << "\t" << bam_get_qname(rec) << "\t" << hdr[file_c]->target_name[rec->core.tid] << "\t" << rec->core.pos << "\t" << hdr[file_c]->target_name[rec->core.mtid] << "\t" << rec->core.mpos << "\t" << (int32_t) rec->core.qual << "\tSR" << std::endl;
-			  }
-			  countMap[file_c][itBp->id].alt.push_back((uint8_t) std::min(aq, (uint32_t) rec->core.qual));
-			  if (hpptr) {
-			    c.isHaplotagged = true;
-			    int hap = bam_aux2i(hpptr);
-			    if (hap == 1) ++countMap[file_c][itBp->id].alth1;
-			    else ++countMap[file_c][itBp->id].alth2;
-			  }
+			if (c.hasDumpFile) {
+			  std::string svid(_addID(itBp->svt));
+			  std::string padNumber = boost::lexical_cast<std::string>(itBp->id);
+			  padNumber.insert(padNumber.begin(), 8 - padNumber.length(), '0');
+			  svid += padNumber;
+			  dumpBuffer << svid << "\t" << c.files[file_c].string() << "\t" << bam_get_qname(rec) << "\t" << hdr[file_c]->target_name[rec->core.tid] << "\t" << rec->core.pos << "\t" << hdr[file_c]->target_name[rec->core.mtid] << "\t" << rec->core.mpos << "\t" << (int32_t) rec->core.qual << "\tSR" << std::endl;
+			}
+			countMap[file_c][itBp->id].alt.push_back((uint8_t) std::min(aq, (uint32_t) rec->core.qual));
+			if (hpptr) {
+			  hasHaplotags = true;
+			  int hap = bam_aux2i(hpptr);
+			  if (hap == 1) ++countMap[file_c][itBp->id].alth1;
+			  else ++countMap[file_c][itBp->id].alth2;
 			}
 		      }
 		    }
@@ -552,31 +645,20 @@ namespace torali {
 	    // First read
 	    lastAlignedPosReads.insert(hash_string(bam_get_qname(rec)));
 	    std::size_t hv = hash_pair(rec);
-	    if (rec->core.tid == rec->core.mtid) {
-	      qualities[hv] = rec->core.qual;
-	      clip[hv] = hasSoftClip;
-	    } else {
-	      qualitiestra[hv] = rec->core.qual;
-	      cliptra[hv] = hasSoftClip;
-	    }
+	    if (rec->core.tid == rec->core.mtid) mates.insert(hv, std::make_pair((uint8_t) rec->core.qual, hasSoftClip));
+	    else matestra.insert(hv, std::make_pair((uint8_t) rec->core.qual, hasSoftClip));
 	  } else {
 	    // Second read
 	    std::size_t hv = hash_pair_mate(rec);
-	    uint8_t pairQuality = 0;
-	    bool pairClip = false;
+	    TQualClip mate;
 	    if (rec->core.tid == rec->core.mtid) {
-	      if (qualities.find(hv) == qualities.end()) continue; // Mate discarded
-	      pairQuality = std::min((uint8_t) qualities[hv], (uint8_t) rec->core.qual);
-	      if ((clip[hv]) || (hasSoftClip)) pairClip = true;
-	      qualities[hv] = 0;
-	      clip[hv] = false;
+	      if (!mates.take(hv, mate)) continue; // Mate discarded
 	    } else {
-	      if (qualitiestra.find(hv) == qualitiestra.end()) continue; // Mate discarded
-	      pairQuality = std::min((uint8_t) qualitiestra[hv], (uint8_t) rec->core.qual);
-	      if ((cliptra[hv]) || (hasSoftClip)) pairClip = true;
-	      qualitiestra[hv] = 0;
-	      cliptra[hv] = false;
+	      if (!matestra.take(hv, mate)) continue; // Mate discarded
 	    }
+	    uint8_t pairQuality = std::min((uint8_t) mate.first, (uint8_t) rec->core.qual);
+	    bool pairClip = false;
+	    if ((mate.second) || (hasSoftClip)) pairClip = true;
 
 	    // Pair quality
 	    if (pairQuality < c.minGenoQual) continue; // Low quality pair
@@ -585,7 +667,8 @@ namespace torali {
 	    if (rec->core.tid == rec->core.mtid) {
 	      // Count mid point (fragment counting)
 	      int32_t midPoint = rec->core.pos + halfAlignmentLength(rec);
-	      if ((midPoint < (int32_t) hdr[file_c]->target_len[refIndex]) && (covFragment[midPoint] < maxCoverage - 1)) ++covFragment[midPoint];
+	      uint32_t w = covFragment.window(midPoint);
+	      covFragment.increment(w, midPoint, maxCoverage);
 	    }
 
 	    // Spanning counting
@@ -616,15 +699,12 @@ namespace torali {
 		  // Account for reference bias
 		  if (++refAlignedSpanCount[file_c][itSpan->id] % 2) {
 		    uint8_t* hpptr = bam_aux_get(rec, "HP");
-#pragma omp critical
-		    {
-		      spanMap[file_c][itSpan->id].ref.push_back(pairQuality);
-		      if (hpptr) {
-			c.isHaplotagged = true;
-			int hap = bam_aux2i(hpptr);
-			if (hap == 1) ++spanMap[file_c][itSpan->id].refh1;
-			else ++spanMap[file_c][itSpan->id].refh2;
-		      }
+		    spanMap[file_c][itSpan->id].ref.push_back(pairQuality);
+		    if (hpptr) {
+		      hasHaplotags = true;
+		      int hap = bam_aux2i(hpptr);
+		      if (hap == 1) ++spanMap[file_c][itSpan->id].refh1;
+		      else ++spanMap[file_c][itSpan->id].refh2;
 		    }
 		  }
 		}
@@ -657,22 +737,19 @@ namespace torali {
 		for(; ((itSpan != spanPoint.end()) && (pend >= itSpan->bppos)); ++itSpan) {
 		  if (svt == itSpan->svt) {
 		    uint8_t* hpptr = bam_aux_get(rec, "HP");
-#pragma omp critical
-		    {
-		      if (c.hasDumpFile) {
-			std::string svid(_addID(itSpan->svt));
-			std::string padNumber = boost::lexical_cast<std::string>(itSpan->id);
-			padNumber.insert(padNumber.begin(), 8 - padNumber.length(), '0');
-			svid += padNumber;
-			dumpOut << svid << "\t" << c.files[file_c].string() << "\t" << bam_get_qname(rec) << "\t" << hdr[file_c]->target_name[rec->core.tid] << "\t" << rec->core.pos << "\t" << hdr[file_c]->target_name[rec->core.mtid] << "\t" << rec->core.mpos << "\t" << (int32_t) rec->core.qual << "\tPE" << std::endl;
-		      }
-		      spanMap[file_c][itSpan->id].alt.push_back(pairQuality);
-		      if (hpptr) {
-			c.isHaplotagged = true;
-			int hap = bam_aux2i(hpptr);
-			if (hap == 1) ++spanMap[file_c][itSpan->id].alth1;
-			else ++spanMap[file_c][itSpan->id].alth2;
-		      }
+		    if (c.hasDumpFile) {
+		      std::string svid(_addID(itSpan->svt));
+		      std::string padNumber = boost::lexical_cast<std::string>(itSpan->id);
+		      padNumber.insert(padNumber.begin(), 8 - padNumber.length(), '0');
+		      svid += padNumber;
+		      dumpBuffer << svid << "\t" << c.files[file_c].string() << "\t" << bam_get_qname(rec) << "\t" << hdr[file_c]->target_name[rec->core.tid] << "\t" << rec->core.pos << "\t" << hdr[file_c]->target_name[rec->core.mtid] << "\t" << rec->core.mpos << "\t" << (int32_t) rec->core.qual << "\tPE" << std::endl;
+		    }
+		    spanMap[file_c][itSpan->id].alt.push_back(pairQuality);
+		    if (hpptr) {
+		      hasHaplotags = true;
+		      int hap = bam_aux2i(hpptr);
+		      if (hap == 1) ++spanMap[file_c][itSpan->id].alth1;
+		      else ++spanMap[file_c][itSpan->id].alth2;
 		    }
 		  }
 		}
@@ -683,8 +760,7 @@ namespace torali {
 	// Clean-up
 	bam_destroy1(rec);
 	hts_itr_destroy(iter);
-	qualities.clear();
-	clip.clear();
+	mates.clear();
 	
 	// Assign fragment and base counts to SVs
 	for(uint32_t i = 0; i < svs.size(); ++i) {
@@ -703,49 +779,47 @@ namespace torali {
 	    int32_t lstart = std::max(svs[i].svStart - halfSize, 0);
 	    int32_t lend = svs[i].svStart;
 	    int32_t covbase = 0;
-	    for(uint32_t k = lstart; ((k < (uint32_t) lend) && (k < hdr[0]->target_len[refIndex])); ++k) {
-	      if (smallSV) covbase += covBases[k];
-	      else covbase += covFragment[k];
-	    }
+	    if (smallSV) covbase = covBases.sum(lstart, lend);
+	    else covbase = covFragment.sum(lstart, lend);
 	    covCount[file_c][svs[i].id].leftRC = covbase;
 
 	    // Actual SV
-	    covbase = 0;
 	    int32_t mstart = svs[i].svStart;
 	    int32_t mend = svs[i].svEnd;
 	    if ((_translocation(svs[i].svt)) || (svs[i].svt == 4)) {
 	      mstart = std::max(svs[i].svStart - halfSize, 0);
 	      mend = std::min(svs[i].svStart + halfSize, (int32_t) hdr[0]->target_len[refIndex]);
 	    }
-	    for(uint32_t k = mstart; ((k < (uint32_t) mend) && (k < hdr[0]->target_len[refIndex])); ++k) {
-	      if (smallSV) covbase += covBases[k];
-	      else covbase += covFragment[k];
-	    }
+	    if (smallSV) covbase = covBases.sum(mstart, mend);
+	    else covbase = covFragment.sum(mstart, mend);
 	    covCount[file_c][svs[i].id].rc = covbase;
 
 	    // Right region
-	    covbase = 0;
 	    int32_t rstart = svs[i].svEnd;
 	    int32_t rend = std::min(svs[i].svEnd + halfSize, (int32_t) hdr[0]->target_len[refIndex]);
 	    if ((_translocation(svs[i].svt)) || (svs[i].svt == 4)) {
 	      rstart = svs[i].svStart;
 	      rend = std::min(svs[i].svStart + halfSize, (int32_t) hdr[0]->target_len[refIndex]);
 	    }
-	    for(uint32_t k = rstart; ((k < (uint32_t) rend) && (k < hdr[0]->target_len[refIndex])); ++k) {
-	      if (smallSV) covbase += covBases[k];
-	      else covbase += covFragment[k];
-	    }
+	    if (smallSV) covbase = covBases.sum(rstart, rend);
+	    else covbase = covFragment.sum(rstart, rend);
 	    covCount[file_c][svs[i].id].rightRC = covbase;
 	  }
 	}
       }
+      dumpStore[file_c] = dumpBuffer.str();
+      if (hasHaplotags) haplotagged[file_c] = 1;
     }
-    // Clean-up
+
+    // Concatenate sample buffers
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      bam_hdr_destroy(hdr[file_c]);
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);    
+      if (haplotagged[file_c]) c.isHaplotagged = true;
+      if (c.hasDumpFile) dumpOut << dumpStore[file_c];
+      std::string().swap(dumpStore[file_c]);
     }
+    
+    // Clean-up
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
 
 }
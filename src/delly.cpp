@@ -17,8 +17,10 @@
 #include "delly.h"
 #include "filter.h"
 #include "merge.h"
+#include "gather.h"
 #include "tegua.h"
 #include "coral.h"
+#include "refimage.h"
 
 using namespace torali;
 
@@ -31,6 +33,7 @@ displayUsage() {
   std::cout << "    call         discover and genotype structural variants" << std::endl;
   std::cout << "    merge        merge structural variants across VCF/BCF files and within a single VCF/BCF file" << std::endl;
   std::cout << "    filter       filter somatic or germline structural variants" << std::endl;
+  std::cout << "    gather       gather region-sharded calls and remove shard boundary duplicates" << std::endl;
   std::cout << std::endl;
   std::cout << "Long-read commands:" << std::endl;
   std::cout << "    lr           long-read SV discovery (currently, only INS and DEL are supported)" << std::endl;
@@ -38,6 +41,9 @@ displayUsage() {
   std::cout << "Read-depth commands:" << std::endl;
   std::cout << "    rd           read-depth normalization" << std::endl;
   std::cout << std::endl;
+  std::cout << "Reference commands:" << std::endl;
+  std::cout << "    ref          build a packed, memory-mapped reference image" << std::endl;
+  std::cout << std::endl;
   std::cout << std::endl;
 }
 
@@ -82,6 +88,12 @@ int main(int argc, char **argv) {
     else if ((std::string(argv[1]) == "merge")) {
       return merge(argc-1,argv+1);
     }
+    else if ((std::string(argv[1]) == "gather")) {
+      return gather(argc-1,argv+1);
+    }
+    else if ((std::string(argv[1]) == "ref")) {
+      return refimage(argc-1,argv+1);
+    }
 
     std::cerr << "Unrecognized command " << std::string(argv[1]) << std::endl;
     return 1;
@@ -58,27 +58,41 @@ namespace torali
     int32_t nchr;
     int32_t minimumFlankSize;
     int32_t indelsize;
+    int32_t scanWindow;
+    int32_t shardMargin;
     uint32_t graphPruning;
     uint32_t minRefSep;
     uint32_t maxReadSep;
     uint32_t minClip;
     uint32_t maxGenoReadCount;
     uint32_t minCliqueSize;
+    uint32_t fusedMemory;
+    uint32_t shard;
     float flankQuality;
+    float maxDepth;
     bool hasExcludeFile;
     bool hasVcfFile;
     bool isHaplotagged;
     bool hasDumpFile;
+    bool fusedScan;
+    bool saPairing;
+    bool hasRegion;
+    bool hasEvidence;
+    bool hasSkipFile;
     bool svtcmd;
     std::set<int32_t> svtset;
+    std::string region;
     DnaScore<int> aliscore;
     boost::filesystem::path outfile;
     boost::filesystem::path vcffile;
     boost::filesystem::path genome;
     boost::filesystem::path exclude;
     boost::filesystem::path dumpfile;
+    boost::filesystem::path evidence;
+    boost::filesystem::path skipfile;
     std::vector<boost::filesystem::path> files;
     std::vector<std::string> sampleName;
+    std::vector<bool> controlFile;
   };
 
 
@@ -92,9 +106,8 @@ namespace torali
     typedef std::vector<StructuralVariantRecord> TVariants;
     TVariants svs;
     
-    // Open header
-    samFile* samfile = sam_open(c.files[0].string().c_str(), "r");
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    // Header
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
     
     // Exclude intervals
     typedef boost::icl::interval_set<uint32_t> TChrIntervals;
@@ -102,10 +115,16 @@ namespace torali
     TRegionsGenome validRegions;
     if (!_parseExcludeIntervals(c, hdr, validRegions)) {
       std::cerr << "Delly couldn't parse exclude intervals!" << std::endl;
-      bam_hdr_destroy(hdr);
-      sam_close(samfile);
       return 1;
     }
+
+    // Shard regions
+    TRegionsGenome shardRegions;
+    if (c.hasRegion) {
+      if (!_parseShardRegions(c, hdr, shardRegions)) {
+	return 1;
+      }
+    }
     
     // Debug code
     //for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
@@ -114,20 +133,22 @@ namespace torali
     //}
     //}
     
-    // Create library objects
+    // Scan the shards plus margin, library parameters use all valid regions
+    TRegionsGenome scanRegions(validRegions);
+    if (c.hasRegion) _restrictToShards(c, hdr, shardRegions, scanRegions);
+
+    // Create library objects, evidence sidecars store them
     typedef std::vector<LibraryInfo> TSampleLibrary;
     TSampleLibrary sampleLib(c.files.size(), LibraryInfo());
-    getLibraryParams(c, validRegions, sampleLib);
+    if ((!c.hasEvidence) || (!_evidenceLibrary(c, hdr, scanRegions, sampleLib))) getLibraryParams(c, validRegions, sampleLib);
     for(uint32_t i = 0; i<sampleLib.size(); ++i) {
       if (sampleLib[i].rs == 0) {
 	std::cerr << "Sample has not enough data to estimate library parameters! File: " << c.files[i].string() << std::endl;
-	bam_hdr_destroy(hdr);
-	sam_close(samfile);
 	return 1;
       }
     }
-    
-    // SV Discovery
+
+    // SV Discovery, only the shards plus margin are scanned while mates and split alignments beyond the margin are checked against all valid regions
     if (!c.hasVcfFile) {
       // Split-read SVs
       typedef std::vector<StructuralVariantRecord> TVariants;
@@ -139,18 +160,19 @@ namespace torali
 	typedef boost::unordered_map<TPosRead, int32_t> TPosReadSV;
 	typedef std::vector<TPosReadSV> TGenomicPosReadSV;
 	TGenomicPosReadSV srStore(c.nchr, TPosReadSV());
-	scanPEandSR(c, validRegions, svs, srSVs, srStore, sampleLib);
+	std::vector<SplitReadCache> srCache;
+	scanPEandSR(c, validRegions, scanRegions, svs, srSVs, srStore, srCache, sampleLib);
 	
 	// Assemble split-read calls
-	assembleSplitReads(c, validRegions, srStore, srSVs);
+	assembleSplitReads(c, validRegions, srStore, srCache, srSVs);
       }
 
       // Sort and merge PE and SR calls
       mergeSort(svs, srSVs);
     } else vcfParse(c, hdr, svs);
-    // Clean-up
-    bam_hdr_destroy(hdr);
-    sam_close(samfile);
+
+    // Keep the SVs starting in the shards, the margin belongs to the neighbouring shards
+    if (c.hasRegion) _selectShardSVs(shardRegions, svs);
 
     // Re-number SVs
     sort(svs.begin(), svs.end(), SortSVs<StructuralVariantRecord>());    
@@ -203,14 +225,28 @@ namespace torali
 
     // Define generic options
     std::string svtype;
+    std::string controls;
+    int32_t ioThreads = 0;
+    int32_t maxOpen = 0;
+    int32_t prefetch = 0;
     boost::program_options::options_description generic("Generic options");
     generic.add_options()
       ("help,?", "show help message")
+      ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
+      ("prefetch", boost::program_options::value<int32_t>(&prefetch)->default_value(4), "record batches decoded ahead of each scan (0: off)")
+      ("max-open", boost::program_options::value<int32_t>(&maxOpen)->default_value(DELLY_MAX_OPEN), "max. open alignment files, idle files beyond are closed")
       ("svtype,t", boost::program_options::value<std::string>(&svtype)->default_value("ALL"), "SV type to compute [DEL, INS, DUP, INV, BND, ALL]")
       ("genome,g", boost::program_options::value<boost::filesystem::path>(&c.genome), "genome fasta file")
       ("exclude,x", boost::program_options::value<boost::filesystem::path>(&c.exclude), "file with regions to exclude")
       ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("sv.bcf"), "SV BCF output file")
       ;
+
+    boost::program_options::options_description shard("Shard options");
+    shard.add_options()
+      ("region", boost::program_options::value<std::string>(&c.region), "call a shard chr:start-end or a BED file of shards")
+      ("shard", boost::program_options::value<uint32_t>(&c.shard)->default_value(0), "shard number (1-based BED line), 0 calls all shards")
+      ("margin", boost::program_options::value<int32_t>(&c.shardMargin)->default_value(100000), "shard overlap margin")
+      ;
     
     boost::program_options::options_description disc("Discovery options");
     disc.add_options()
@@ -221,6 +257,13 @@ namespace torali
       ("min-clique-size,z", boost::program_options::value<uint32_t>(&c.minCliqueSize)->default_value(2), "min. PE/SR clique size")
       ("minrefsep,m", boost::program_options::value<uint32_t>(&c.minRefSep)->default_value(25), "min. reference separation")
       ("maxreadsep,n", boost::program_options::value<uint32_t>(&c.maxReadSep)->default_value(40), "max. read separation")
+      ("fused,f", "capture split-reads during the scan, no separate assembly pass")
+      ("fused-memory", boost::program_options::value<uint32_t>(&c.fusedMemory)->default_value(2048), "max. memory (MB) for captured split-reads")
+      ("sa-pairing", "split-reads from the SA tag of primary alignments, supplementary alignments are skipped")
+      ("max-depth", boost::program_options::value<float>(&c.maxDepth)->default_value(0), "down-sample 1kbp bins above max-depth x median read depth (0: off)")
+      ("skipped-bed", boost::program_options::value<boost::filesystem::path>(&c.skipfile), "BED output of down-sampled high-depth bins")
+      ("evidence,e", boost::program_options::value<boost::filesystem::path>(&c.evidence), "directory of SV-evidence sidecars, re-calls with stricter cutoffs skip the scan")
+      ("control", boost::program_options::value<std::string>(&controls), "comma-separated control samples, genotyped at the SVs of the other samples only")
       ;
     
     boost::program_options::options_description geno("Genotyping options");
@@ -236,6 +279,7 @@ namespace torali
       ("input-file", boost::program_options::value< std::vector<boost::filesystem::path> >(&c.files), "input file")
       ("pruning,j", boost::program_options::value<uint32_t>(&c.graphPruning)->default_value(1000), "PE graph pruning cutoff")
       ("max-geno-count,a", boost::program_options::value<uint32_t>(&c.maxGenoReadCount)->default_value(250), "max. number of reads aligned for SR genotyping")
+      ("scan-window", boost::program_options::value<int32_t>(&c.scanWindow)->default_value(10000000), "window size of parallel scan tasks")
       ;
     
     boost::program_options::positional_options_description pos_args;
@@ -243,9 +287,9 @@ namespace torali
     
     // Set the visibility
     boost::program_options::options_description cmdline_options;
-    cmdline_options.add(generic).add(disc).add(geno).add(hidden);
+    cmdline_options.add(generic).add(shard).add(disc).add(geno).add(hidden);
     boost::program_options::options_description visible_options;
-    visible_options.add(generic).add(disc).add(geno);
+    visible_options.add(generic).add(shard).add(disc).add(geno);
     boost::program_options::variables_map vm;
     boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cmdline_options).positional(pos_args).run(), vm);
     boost::program_options::notify(vm);
@@ -266,72 +310,113 @@ namespace torali
     if (vm.count("dump")) c.hasDumpFile = true;
     else c.hasDumpFile = false;
 
+    // Fused split-read capture
+    if (vm.count("fused")) c.fusedScan = true;
+    else c.fusedScan = false;
+
+    // SV-evidence sidecars
+    if ((vm.count("evidence")) && (!vm.count("vcffile"))) {
+      c.hasEvidence = true;
+      boost::system::error_code ec;
+      boost::filesystem::create_directories(c.evidence, ec);
+      if (!boost::filesystem::is_directory(c.evidence)) {
+	std::cerr << "Evidence directory could not be created: " << c.evidence.string() << std::endl;
+	return 1;
+      }
+    } else c.hasEvidence = false;
+
+    // SA tag split-read pairing, sidecars keep the supplementary alignments
+    if (vm.count("sa-pairing")) {
+      if (c.hasEvidence) {
+	std::cerr << "Warning: --sa-pairing is ignored with --evidence" << std::endl;
+	c.saPairing = false;
+      } else c.saPairing = true;
+    } else c.saPairing = false;
+
+    // Depth monitor
+    if (vm.count("skipped-bed")) c.hasSkipFile = true;
+    else c.hasSkipFile = false;
+    if (c.maxDepth < 0) c.maxDepth = 0;
+
     // Clique size
     if (c.minCliqueSize < 2) c.minCliqueSize = 2;
     
     // Check quality cuts
     if (c.minMapQual > c.minTraQual) c.minTraQual = c.minMapQual;
+
+    // Scan window
+    if (c.scanWindow < 100000) c.scanWindow = 100000;
+
+    // Region-sharded calling
+    if (vm.count("region")) c.hasRegion = true;
+    else c.hasRegion = false;
+    if (c.shardMargin < 0) c.shardMargin = 0;
+
+    // Split alignments beyond the shard margin are only seen through the SA tag of the alignment in the shard
+    if ((c.hasRegion) && (!c.hasEvidence)) c.saPairing = true;
+    else if ((c.hasRegion) && (c.hasEvidence)) std::cerr << "Warning: split-reads with an alignment beyond --margin are not recovered with --evidence" << std::endl;
     
     // Check reference
     if (!(boost::filesystem::exists(c.genome) && boost::filesystem::is_regular_file(c.genome) && boost::filesystem::file_size(c.genome))) {
       std::cerr << "Reference file is missing: " << c.genome.string() << std::endl;
       return 1;
     } else {
-      faidx_t* fai = fai_load(c.genome.string().c_str());
+      faidx_t* fai = _hFaiOpen(c.genome.string());
       if (fai == NULL) {
 	if (fai_build(c.genome.string().c_str()) == -1) {
 	  std::cerr << "Fail to open genome fai index for " << c.genome.string() << std::endl;
 	  return 1;
-	} else fai = fai_load(c.genome.string().c_str());
+	} else fai = _hFaiOpen(c.genome.string());
       }
-      fai_destroy(fai);
+      _hFaiClose(fai);
     }
 
-    // Check input files
-    c.sampleName.resize(c.files.size());
-    c.nchr = 0;
+    // Shared I/O thread pool and alignment handles
+    _ioPoolInit(ioThreads);
+    _ioPrefetchInit(prefetch);
+    _hPoolInit(maxOpen);
+
+    // An alignment stream on stdin ('-') is spooled next to the output file and indexed on the fly
+    IOSpool spool;
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      if (!(boost::filesystem::exists(c.files[file_c]) && boost::filesystem::is_regular_file(c.files[file_c]) && boost::filesystem::file_size(c.files[file_c]))) {
-	std::cerr << "Alignment file is missing: " << c.files[file_c].string() << std::endl;
-	return 1;
-      }
-      samFile* samfile = sam_open(c.files[file_c].string().c_str(), "r");
-      if (samfile == NULL) {
-	std::cerr << "Fail to open file " << c.files[file_c].string() << std::endl;
-	return 1;
-      }
-      hts_idx_t* idx = sam_index_load(samfile, c.files[file_c].string().c_str());
-      if (idx == NULL) {
-	std::cerr << "Fail to open index for " << c.files[file_c].string() << std::endl;
+      if (c.files[file_c].string() != "-") continue;
+      if (!spool.file.empty()) {
+	std::cerr << "Only one input file can be read from stdin!" << std::endl;
 	return 1;
       }
-      bam_hdr_t* hdr = sam_hdr_read(samfile);
-      if (hdr == NULL) {
-	std::cerr << "Fail to open header for " << c.files[file_c].string() << std::endl;
-	return 1;
-      }
-      if (!c.nchr) c.nchr = hdr->n_targets;
-      else {
-	if (c.nchr != hdr->n_targets) {
-	  std::cerr << "BAM files have different number of chromosomes!" << std::endl;
-	  return 1;
+      spool.file = c.outfile.string() + ".stdin.bam";
+      boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+      std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Spooling alignment stream to " << spool.file << std::endl;
+      if (!_ioSpoolStream("-", spool.file)) return 1;
+      c.files[file_c] = spool.file;
+    }
+
+    // Check input files
+    if (checkAlignmentFiles(c)) return 1;
+    
+    // Control samples skip the SV discovery
+    c.controlFile.assign(c.files.size(), false);
+    if ((vm.count("control")) && (!vm.count("vcffile"))) {
+      typedef boost::tokenizer< boost::char_separator<char> > Tokenizer;
+      boost::char_separator<char> sep(",");
+      Tokenizer tokens(controls, sep);
+      for(Tokenizer::iterator tokIter = tokens.begin(); tokIter != tokens.end(); ++tokIter) {
+	bool found = false;
+	for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
+	  if ((c.sampleName[file_c] == *tokIter) || (c.files[file_c].string() == *tokIter)) {
+	    c.controlFile[file_c] = true;
+	    found = true;
+	  }
 	}
-      }
-      faidx_t* fai = fai_load(c.genome.string().c_str());
-      for(int32_t refIndex=0; refIndex < hdr->n_targets; ++refIndex) {
-	std::string tname(hdr->target_name[refIndex]);
-	if (!faidx_has_seq(fai, tname.c_str())) {
-	  std::cerr << "BAM file chromosome " << hdr->target_name[refIndex] << " is NOT present in your reference file " << c.genome.string() << std::endl;
+	if (!found) {
+	  std::cerr << "Control sample is not among the input files: " << *tokIter << std::endl;
 	  return 1;
 	}
       }
-      fai_destroy(fai);
-      std::string sampleName = "unknown";
-      getSMTag(std::string(hdr->text), c.files[file_c].stem().string(), sampleName);
-      c.sampleName[file_c] = sampleName;
-      bam_hdr_destroy(hdr);
-      hts_idx_destroy(idx);
-      sam_close(samfile);
+      if (std::find(c.controlFile.begin(), c.controlFile.end(), false) == c.controlFile.end()) {
+	std::cerr << "At least one input sample needs to be a non-control sample!" << std::endl;
+	return 1;
+      }
     }
     
     // Check exclude file
@@ -349,7 +434,7 @@ namespace torali
 	std::cerr << "Input VCF/BCF file is missing: " << c.vcffile.string() << std::endl;
 	return 1;
       }
-      htsFile* ifile = bcf_open(c.vcffile.string().c_str(), "r");
+      htsFile* ifile = _ioAttach(bcf_open(c.vcffile.string().c_str(), "r"));
       if (ifile == NULL) {
 	std::cerr << "Fail to open file " << c.vcffile.string() << std::endl;
 	return 1;
@@ -366,7 +451,8 @@ namespace torali
     
     // Check output directory
     if (!_outfileValid(c.outfile)) return 1;
-    
+    if ((c.hasSkipFile) && (!_outfileValid(c.skipfile))) return 1;
+
     // Show cmd
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
@@ -0,0 +1,315 @@
+#ifndef EVIDENCE_H
+#define EVIDENCE_H
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+#include <boost/filesystem.hpp>
+
+#include <htslib/bgzf.h>
+#include <htslib/sam.h>
+
+#include "util.h"
+#include "junction.h"
+#include "cluster.h"
+
+
+namespace torali
+{
+
+  // Evidence is captured at these floors, re-calls may use any stricter cutoff
+  #ifndef DELLY_EVIDENCE_MINCLIP
+  #define DELLY_EVIDENCE_MINCLIP 15
+  #endif
+
+  #ifndef DELLY_EVIDENCE_MAD
+  #define DELLY_EVIDENCE_MAD 5
+  #endif
+
+  #define DELLY_EVIDENCE_VERSION 3
+
+  // Split-read junction with the length of its CIGAR operation
+  struct EvidenceJunction {
+    uint64_t seed;
+    uint32_t oplen;
+    int32_t refidx;
+    int32_t rstart;
+    int32_t refpos;
+    int32_t seqpos;
+    uint16_t qual;
+    uint8_t forward;
+    uint8_t scleft;
+    uint8_t clip;
+    uint8_t sa; // 0: no SA tag, 1: SA on the same chromosome, 2: SA on another chromosome
+
+    EvidenceJunction() {}
+    EvidenceJunction(uint64_t const s, uint32_t const len, bool const cl, Junction const& j) : seed(s), oplen(len), refidx(j.refidx), rstart(j.rstart), refpos(j.refpos), seqpos(j.seqpos), qual(j.qual), forward(j.forward), scleft(j.scleft), clip(cl), sa(0) {}
+
+    inline Junction
+    junction() const {
+      return Junction(forward, scleft, refidx, rstart, refpos, seqpos, qual);
+    }
+  };
+
+  // Discordant pair, deletions keep the insert size for the MAD cutoff
+  struct EvidencePair {
+    int32_t tid;
+    int32_t pos;
+    int32_t mtid;
+    int32_t mpos;
+    int32_t isize;
+    uint16_t alen;
+    uint16_t malen;
+    uint8_t qual;
+    uint8_t svt;
+  };
+
+  // Sidecar index header: capture cutoffs, alignment file identity and library parameters
+  struct EvidenceHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t nTargets;
+    uint16_t minMapQual;
+    uint16_t madCutoff;
+    uint32_t minClip;
+    uint32_t minRefSep;
+    int32_t rs;
+    int32_t median;
+    int32_t mad;
+    float maxDepth;
+    uint64_t regionHash;
+    uint64_t fileSize;
+    int64_t mtime;
+  };
+
+
+  // Sidecars are only valid for the scanned regions
+  template<typename TValidRegion>
+  inline uint64_t
+  _evidenceRegionHash(bam_hdr_t const* hdr, TValidRegion const& validRegions) {
+    typedef typename TValidRegion::value_type TChrIntervals;
+    uint64_t h = 14695981039346656037ULL;
+    for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+      uint32_t val[3] = {(uint32_t) refIndex, hdr->target_len[refIndex], 0};
+      for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); vRIt != validRegions[refIndex].end(); ++vRIt) {
+	val[1] = vRIt->lower();
+	val[2] = vRIt->upper();
+	unsigned char const* p = (unsigned char const*) val;
+	for(uint32_t i = 0; i < sizeof(val); ++i) h = (h ^ p[i]) * 1099511628211ULL;
+      }
+    }
+    return h;
+  }
+
+  template<typename TConfig>
+  inline boost::filesystem::path
+  _evidencePath(TConfig const& c, uint32_t const file_c, uint64_t const regionHash) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) regionHash);
+    return c.evidence / (c.files[file_c].filename().string() + "." + std::string(hex) + ".evi");
+  }
+
+  // Read the sidecar index, false if missing, stale, down-sampled differently or captured with looser cutoffs than needed
+  template<typename TConfig>
+  inline bool
+  _readEvidenceIndex(TConfig const& c, uint32_t const file_c, uint64_t const regionHash, bam_hdr_t const* hdr, EvidenceHeader& eh, std::vector<int64_t>& offsets) {
+    std::string idxfile = _evidencePath(c, file_c, regionHash).string() + ".idx";
+    if (!boost::filesystem::exists(idxfile)) return false;
+    std::ifstream ifs(idxfile.c_str(), std::ios::binary);
+    if (!ifs.read((char*) &eh, sizeof(EvidenceHeader))) return false;
+    if ((std::strncmp(eh.magic, "DLYEVI", 6) != 0) || (eh.version != DELLY_EVIDENCE_VERSION) || (eh.nTargets != hdr->n_targets) || (eh.regionHash != regionHash)) return false;
+    if ((eh.fileSize != (uint64_t) boost::filesystem::file_size(c.files[file_c])) || (eh.mtime != (int64_t) boost::filesystem::last_write_time(c.files[file_c]))) return false;
+    if (eh.maxDepth != c.maxDepth) return false;
+    if ((c.minMapQual < eh.minMapQual) || (c.madCutoff < eh.madCutoff) || (c.minClip < eh.minClip) || (c.minRefSep < eh.minRefSep)) return false;
+    offsets.resize(eh.nTargets);
+    if (!ifs.read((char*) &offsets[0], eh.nTargets * sizeof(int64_t))) return false;
+    return true;
+  }
+
+  // Library parameters of all samples from the sidecars, false if any sample needs a BAM scan
+  template<typename TConfig, typename TValidRegion, typename TSampleLibrary>
+  inline bool
+  _evidenceLibrary(TConfig const& c, bam_hdr_t const* hdr, TValidRegion const& validRegions, TSampleLibrary& sampleLib) {
+    uint64_t regionHash = _evidenceRegionHash(hdr, validRegions);
+    TSampleLibrary evLib(sampleLib.size(), LibraryInfo());
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+      EvidenceHeader eh;
+      std::vector<int64_t> offsets;
+      if (!_readEvidenceIndex(c, file_c, regionHash, hdr, eh, offsets)) return false;
+      evLib[file_c].rs = eh.rs;
+      if (eh.median) {
+	evLib[file_c].median = eh.median;
+	evLib[file_c].mad = eh.mad;
+	_libraryCutoffs(c, evLib[file_c]);
+      }
+    }
+    sampleLib.swap(evLib);
+    return true;
+  }
+
+  // Write the evidence of one sample, chromosome blocks go to a BGZF file and their offsets to the index
+  template<typename TConfig, typename TSvtBamRecord>
+  inline bool
+  _writeEvidence(TConfig const& c, uint32_t const file_c, uint64_t const regionHash, bam_hdr_t const* hdr, LibraryInfo const& lib, std::vector<uint32_t> const& saSupp, std::vector<uint32_t> const& noSaSupp, std::vector<std::vector<EvidenceJunction> > const& junctions, TSvtBamRecord const& bamRec, std::vector<int32_t> const& delISize) {
+    // Pairs by chromosome of the first read
+    std::vector<std::vector<EvidencePair> > pairs(hdr->n_targets);
+    for(uint32_t svt = 0; svt < bamRec.size(); ++svt) {
+      for(uint32_t i = 0; i < bamRec[svt].size(); ++i) {
+	EvidencePair ep;
+	std::memset(&ep, 0, sizeof(EvidencePair));
+	ep.tid = bamRec[svt].tid[i];
+	ep.pos = bamRec[svt].pos[i];
+	ep.mtid = bamRec[svt].mtid[i];
+	ep.mpos = bamRec[svt].mpos[i];
+	if (svt == 2) ep.isize = delISize[i];
+	ep.alen = bamRec[svt].alen[i];
+	ep.malen = bamRec[svt].malen[i];
+	ep.qual = bamRec[svt].qual[i];
+	ep.svt = svt;
+	pairs[ep.tid].push_back(ep);
+      }
+    }
+
+    boost::filesystem::path evifile = _evidencePath(c, file_c, regionHash);
+    std::string idxfile = evifile.string() + ".idx";
+    if (boost::filesystem::exists(idxfile)) boost::filesystem::remove(idxfile);
+    BGZF* fp = bgzf_open(evifile.string().c_str(), "w");
+    if (fp == NULL) {
+      std::cerr << "Warning: Failed to write evidence file " << evifile.string() << std::endl;
+      return false;
+    }
+    bool ok = true;
+    std::vector<int64_t> offsets(hdr->n_targets, -1);
+    for(int32_t refIndex = 0; ((ok) && (refIndex < hdr->n_targets)); ++refIndex) {
+      if ((!saSupp[refIndex]) && (!noSaSupp[refIndex]) && (junctions[refIndex].empty()) && (pairs[refIndex].empty())) continue;
+      offsets[refIndex] = bgzf_tell(fp);
+      uint32_t sa[2] = {saSupp[refIndex], noSaSupp[refIndex]};
+      uint64_t n[2] = {junctions[refIndex].size(), pairs[refIndex].size()};
+      if (bgzf_write(fp, sa, sizeof(sa)) < 0) ok = false;
+      if (bgzf_write(fp, n, sizeof(n)) < 0) ok = false;
+      if ((n[0]) && (bgzf_write(fp, &junctions[refIndex][0], n[0] * sizeof(EvidenceJunction)) < 0)) ok = false;
+      if ((n[1]) && (bgzf_write(fp, &pairs[refIndex][0], n[1] * sizeof(EvidencePair)) < 0)) ok = false;
+    }
+    if (bgzf_close(fp) != 0) ok = false;
+    if (!ok) {
+      std::cerr << "Warning: Failed to write evidence file " << evifile.string() << std::endl;
+      return false;
+    }
+
+    // The index is written last and marks a complete sidecar
+    EvidenceHeader eh;
+    std::memset(&eh, 0, sizeof(EvidenceHeader));
+    std::memcpy(eh.magic, "DLYEVI2", 8);
+    eh.version = DELLY_EVIDENCE_VERSION;
+    eh.nTargets = hdr->n_targets;
+    eh.minMapQual = c.minMapQual;
+    eh.madCutoff = c.madCutoff;
+    eh.minClip = c.minClip;
+    eh.minRefSep = c.minRefSep;
+    eh.rs = lib.rs;
+    eh.median = lib.median;
+    eh.mad = lib.mad;
+    eh.maxDepth = c.maxDepth;
+    eh.regionHash = regionHash;
+    eh.fileSize = boost::filesystem::file_size(c.files[file_c]);
+    eh.mtime = boost::filesystem::last_write_time(c.files[file_c]);
+    std::ofstream ofs(idxfile.c_str(), std::ios::binary);
+    ofs.write((char const*) &eh, sizeof(EvidenceHeader));
+    ofs.write((char const*) &offsets[0], offsets.size() * sizeof(int64_t));
+    ofs.close();
+    if (!ofs) {
+      std::cerr << "Warning: Failed to write evidence index " << idxfile << std::endl;
+      boost::filesystem::remove(idxfile);
+      return false;
+    }
+    return true;
+  }
+
+  // Re-apply the cutoffs of this run to the sidecar evidence and select PE and SR records
+  template<typename TConfig, typename TSvtBamRecord, typename TSvtSRBamRecord>
+  inline bool
+  _evidenceCall(TConfig const& c, uint32_t const file_c, uint64_t const regionHash, bam_hdr_t const* hdr, LibraryInfo& lib, TSvtBamRecord& bamRec, TSvtSRBamRecord& srRec) {
+    typedef std::vector<Junction> TJunctionVector;
+    typedef std::map<uint64_t, TJunctionVector> TReadBp;
+
+    EvidenceHeader eh;
+    std::vector<int64_t> offsets;
+    if (!_readEvidenceIndex(c, file_c, regionHash, hdr, eh, offsets)) return false;
+    boost::filesystem::path evifile = _evidencePath(c, file_c, regionHash);
+    BGZF* fp = bgzf_open(evifile.string().c_str(), "r");
+    if (fp == NULL) return false;
+    bool ok = true;
+    TReadBp traBp;
+    std::vector<EvidenceJunction> junctions;
+    std::vector<EvidencePair> pairs;
+    for(int32_t refIndex = 0; ((ok) && (refIndex < hdr->n_targets)); ++refIndex) {
+      if (offsets[refIndex] < 0) continue;
+      uint32_t sa[2];
+      uint64_t n[2];
+      if (bgzf_seek(fp, offsets[refIndex], SEEK_SET) < 0) ok = false;
+      else if ((bgzf_read(fp, sa, sizeof(sa)) != (ssize_t) sizeof(sa)) || (bgzf_read(fp, n, sizeof(n)) != (ssize_t) sizeof(n))) ok = false;
+      if (!ok) break;
+      junctions.resize(n[0]);
+      pairs.resize(n[1]);
+      if ((n[0]) && (bgzf_read(fp, &junctions[0], n[0] * sizeof(EvidenceJunction)) != (ssize_t) (n[0] * sizeof(EvidenceJunction)))) ok = false;
+      if ((n[1]) && (bgzf_read(fp, &pairs[0], n[1] * sizeof(EvidencePair)) != (ssize_t) (n[1] * sizeof(EvidencePair)))) ok = false;
+      if (!ok) break;
+
+      // Split-read junctions passing the cutoffs
+      bool saTagged = ((sa[0]) && (!sa[1]));
+      TReadBp readBp;
+      std::vector<uint64_t> candidates;
+      for(uint64_t i = 0; i < n[0]; ++i) {
+	EvidenceJunction const& ej = junctions[i];
+	if (ej.qual < c.minMapQual) continue;
+	if (ej.clip) {
+	  if (ej.oplen <= c.minClip) continue;
+	  if ((ej.sa == 2) || ((ej.sa == 0) && (!saTagged))) candidates.push_back(ej.seed);
+	} else if (ej.oplen <= c.minRefSep) continue;
+	readBp[ej.seed].push_back(ej.junction());
+      }
+      std::sort(candidates.begin(), candidates.end());
+      for(typename TReadBp::iterator it = readBp.begin(); it != readBp.end(); ++it) {
+	std::sort(it->second.begin(), it->second.end(), SortJunction<Junction>());
+      }
+      if ((!c.svtcmd) || (c.svtset.find(2) != c.svtset.end())) selectDeletions(c, readBp, srRec);
+      if ((!c.svtcmd) || (c.svtset.find(3) != c.svtset.end())) selectDuplications(c, readBp, srRec);
+      if ((!c.svtcmd) || (c.svtset.find(0) != c.svtset.end()) || (c.svtset.find(1) != c.svtset.end())) selectInversions(c, readBp, srRec);
+      if ((!c.svtcmd) || (c.svtset.find(4) != c.svtset.end())) selectInsertions(c, readBp, srRec);
+      for(typename TReadBp::iterator it = readBp.begin(); it != readBp.end(); ++it) {
+	if (std::binary_search(candidates.begin(), candidates.end(), it->first)) {
+	  TJunctionVector& jv = traBp[it->first];
+	  jv.insert(jv.end(), it->second.begin(), it->second.end());
+	}
+      }
+
+      // Discordant pairs passing the cutoffs
+      for(uint64_t i = 0; i < n[1]; ++i) {
+	EvidencePair const& ep = pairs[i];
+	if (ep.qual < c.minMapQual) continue;
+	if ((ep.tid != ep.mtid) && (ep.qual < c.minTraQual)) continue;
+	if ((ep.svt == 2) && (lib.maxISizeCutoff > std::abs(ep.isize))) continue;
+	if ((c.svtcmd) && (c.svtset.find(ep.svt) == c.svtset.end())) continue;
+	bamRec[ep.svt].push_back(BamAlignRecord(ep.tid, ep.pos, ep.mtid, ep.mpos, ep.qual, ep.alen, ep.malen, file_c));
+	++lib.abnormal_pairs;
+      }
+    }
+    bgzf_close(fp);
+    if (!ok) {
+      std::cerr << "Warning: Corrupt evidence file " << evifile.string() << std::endl;
+      return false;
+    }
+
+    // Inter-chromosomal split-reads
+    for(typename TReadBp::iterator it = traBp.begin(); it != traBp.end(); ++it) {
+      std::sort(it->second.begin(), it->second.end(), SortJunction<Junction>());
+    }
+    if ((!c.svtcmd) || (c.svtset.find(DELLY_SVT_TRANS) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 1) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 2) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 3) != c.svtset.end())) selectTranslocations(c, traBp, srRec);
+    return true;
+  }
+
+}
+
+#endif
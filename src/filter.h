@@ -69,11 +69,11 @@ inline int
 filterRun(TFilterConfig const& c) {
 
   // Load bcf file
-  htsFile* ifile = hts_open(c.vcffile.string().c_str(), "r");
+  htsFile* ifile = _ioAttach(hts_open(c.vcffile.string().c_str(), "r"));
   bcf_hdr_t* hdr = bcf_hdr_read(ifile);
 
   // Open output VCF file
-  htsFile *ofile = hts_open(c.outfile.string().c_str(), "wb");
+  htsFile *ofile = _ioAttach(hts_open(c.outfile.string().c_str(), "wb"));
   bcf_hdr_t *hdr_out = bcf_hdr_dup(hdr);
   if (c.filter == "somatic") {
     bcf_hdr_remove(hdr_out, BCF_HL_INFO, "RDRATIO");
@@ -119,7 +119,7 @@ filterRun(TFilterConfig const& c) {
   boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
   std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Filtering VCF/BCF file" << std::endl;
   bcf1_t* rec = bcf_init1();
-  while (bcf_read(ifile, hdr, rec) == 0) {
+  while (_ioBcfRead(ifile, hdr, rec) == 0) {
     bcf_unpack(rec, BCF_UN_INFO);
 
     // Check SV type
@@ -293,9 +293,11 @@ int filter(int argc, char **argv) {
   FilterConfig c;
 
   // Define generic options
+  int32_t ioThreads = 0;
   boost::program_options::options_description generic("Generic options");
   generic.add_options()
     ("help,?", "show help message")
+    ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
     ("filter,f", boost::program_options::value<std::string>(&c.filter)->default_value("somatic"), "Filter mode (somatic, germline)")
     ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("sv.bcf"), "Filtered SV BCF output file")
     ("altaf,a", boost::program_options::value<float>(&c.altaf)->default_value(0.2), "min. fractional ALT support")
@@ -411,7 +413,7 @@ int filter(int argc, char **argv) {
       std::cerr << "Input VCF/BCF file is missing: " << c.vcffile.string() << std::endl;
       return 1;
     }
-    htsFile* ifile = bcf_open(c.vcffile.string().c_str(), "r");
+    htsFile* ifile = _ioAttach(bcf_open(c.vcffile.string().c_str(), "r"));
     if (ifile == NULL) {
       std::cerr << "Fail to open file " << c.vcffile.string() << std::endl;
       return 1;
@@ -455,6 +457,9 @@ int filter(int argc, char **argv) {
     bcf_close(ifile);
   }
 
+  // Shared I/O thread pool
+  _ioPoolInit(ioThreads);
+
   // Show cmd
   boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
   std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
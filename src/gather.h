@@ -0,0 +1,280 @@
+#ifndef GATHER_H
+#define GATHER_H
+
+#include <iostream>
+#include <fstream>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/progress.hpp>
+
+#include <htslib/vcf.h>
+
+#include "tags.h"
+#include "version.h"
+#include "util.h"
+#include "merge.h"
+
+namespace torali
+{
+
+
+struct GatherConfig {
+  uint32_t bpoffset;
+  float recoverlap;
+  boost::filesystem::path outfile;
+  std::vector<boost::filesystem::path> files;
+};
+
+struct GatherRecord {
+  bool precise;
+  int32_t rid;
+  int32_t pos;
+  int32_t end;
+  int32_t support;
+  float qual;
+  std::string svt;
+  std::string ct;
+  std::string chr2;
+  bcf1_t* rec;
+
+  GatherRecord() : precise(false), rid(0), pos(0), end(0), support(0), qual(0), rec(NULL) {}
+};
+
+template<typename TRecord>
+struct SortGatherRecords : public std::binary_function<TRecord, TRecord, bool>
+{
+  inline bool operator()(TRecord const& s1, TRecord const& s2) const {
+    return ((s1.rid < s2.rid) || ((s1.rid == s2.rid) && ((s1.pos < s2.pos) || ((s1.pos == s2.pos) && (s1.end < s2.end)))));
+  }
+};
+
+// Same SV called by two neighbouring shards?
+template<typename TGatherConfig>
+inline bool
+_gatherDuplicate(TGatherConfig const& c, GatherRecord const& r1, GatherRecord const& r2) {
+  if ((r1.svt != r2.svt) || (r1.ct != r2.ct) || (r1.chr2 != r2.chr2)) return false;
+  if ((std::abs(r1.pos - r2.pos) > (int32_t) c.bpoffset) || (std::abs(r1.end - r2.end) > (int32_t) c.bpoffset)) return false;
+  if (r1.svt == "BND") return true;
+  return (recOverlap(r1.pos, r1.end, r2.pos, r2.end) >= c.recoverlap);
+}
+
+// Precise calls first, then PE+SR support and quality
+inline bool
+_gatherBetter(GatherRecord const& r1, GatherRecord const& r2) {
+  if (r1.precise != r2.precise) return r1.precise;
+  if (r1.support != r2.support) return (r1.support > r2.support);
+  return (r1.qual > r2.qual);
+}
+
+template<typename TGatherConfig>
+inline int
+gatherRun(TGatherConfig const& c) {
+  boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Reading shard BCF files" << std::endl;
+  boost::progress_display show_progress( c.files.size() );
+
+  // Output header is the header of the first shard
+  htsFile* ifile = _ioAttach(bcf_open(c.files[0].string().c_str(), "r"));
+  bcf_hdr_t* hdr0 = bcf_hdr_read(ifile);
+  bcf_close(ifile);
+  bcf_hdr_t* hdr_out = bcf_hdr_dup(hdr0);
+  bcf_hdr_destroy(hdr0);
+
+  // Collect all shard calls
+  typedef std::vector<GatherRecord> TGatherRecords;
+  TGatherRecords grec;
+  int32_t nsvend = 0;
+  int32_t* svend = NULL;
+  int32_t npos2 = 0;
+  int32_t* pos2 = NULL;
+  int32_t npe = 0;
+  int32_t* pe = NULL;
+  int32_t nsr = 0;
+  int32_t* sr = NULL;
+  int32_t nsvt = 0;
+  char* svt = NULL;
+  int32_t nct = 0;
+  char* ct = NULL;
+  int32_t nchr2 = 0;
+  char* chr2 = NULL;
+  for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+    ++show_progress;
+    ifile = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
+    bcf_hdr_t* hdr = bcf_hdr_read(ifile);
+    bool sameSamples = (bcf_hdr_nsamples(hdr) == bcf_hdr_nsamples(hdr_out));
+    for(int32_t i = 0; ((sameSamples) && (i < bcf_hdr_nsamples(hdr))); ++i) {
+      if (std::string(hdr->samples[i]) != std::string(hdr_out->samples[i])) sameSamples = false;
+    }
+    if (!sameSamples) {
+      std::cerr << "Shard BCF files need to have identical samples: " << c.files[file_c].string() << std::endl;
+      bcf_hdr_destroy(hdr);
+      bcf_close(ifile);
+      bcf_hdr_destroy(hdr_out);
+      for(uint32_t i = 0; i < grec.size(); ++i) bcf_destroy(grec[i].rec);
+      return 1;
+    }
+    bcf1_t* rec = bcf_init();
+    while (_ioBcfRead(ifile, hdr, rec) == 0) {
+      bcf_unpack(rec, BCF_UN_ALL);
+      if (file_c) bcf_translate(hdr_out, hdr, rec);
+      GatherRecord gr;
+      gr.rid = rec->rid;
+      gr.pos = rec->pos;
+      gr.end = rec->pos + 2;
+      gr.qual = rec->qual;
+      gr.precise = (bcf_get_info_flag(hdr_out, rec, "PRECISE", 0, 0) > 0);
+      if (bcf_get_info_string(hdr_out, rec, "SVTYPE", &svt, &nsvt) > 0) gr.svt = std::string(svt);
+      if (bcf_get_info_string(hdr_out, rec, "CT", &ct, &nct) > 0) gr.ct = std::string(ct);
+      if (bcf_get_info_string(hdr_out, rec, "CHR2", &chr2, &nchr2) > 0) gr.chr2 = std::string(chr2);
+      else gr.chr2 = std::string(bcf_hdr_id2name(hdr_out, rec->rid));
+      if (bcf_get_info_int32(hdr_out, rec, "POS2", &pos2, &npos2) > 0) gr.end = *pos2;
+      else if (bcf_get_info_int32(hdr_out, rec, "END", &svend, &nsvend) > 0) gr.end = *svend;
+      if (bcf_get_info_int32(hdr_out, rec, "PE", &pe, &npe) > 0) gr.support += *pe;
+      if (bcf_get_info_int32(hdr_out, rec, "SR", &sr, &nsr) > 0) gr.support += *sr;
+      gr.rec = bcf_dup(rec);
+      grec.push_back(gr);
+    }
+    bcf_destroy(rec);
+    bcf_hdr_destroy(hdr);
+    bcf_close(ifile);
+  }
+  if (svend != NULL) free(svend);
+  if (pos2 != NULL) free(pos2);
+  if (pe != NULL) free(pe);
+  if (sr != NULL) free(sr);
+  if (svt != NULL) free(svt);
+  if (ct != NULL) free(ct);
+  if (chr2 != NULL) free(chr2);
+
+  // De-duplicate calls at the shard boundaries
+  std::sort(grec.begin(), grec.end(), SortGatherRecords<GatherRecord>());
+  std::vector<bool> discard(grec.size(), false);
+  uint32_t duplicates = 0;
+  for(uint32_t i = 0; i < grec.size(); ++i) {
+    for(int32_t j = (int32_t) i - 1; ((j >= 0) && (grec[j].rid == grec[i].rid) && (grec[i].pos - grec[j].pos <= (int32_t) c.bpoffset)); --j) {
+      if (discard[j]) continue;
+      if (_gatherDuplicate(c, grec[i], grec[j])) {
+	++duplicates;
+	if (_gatherBetter(grec[i], grec[j])) discard[j] = true;
+	else {
+	  discard[i] = true;
+	  break;
+	}
+      }
+    }
+  }
+
+  // Write the gathered calls with genome-wide unique IDs
+  now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Writing " << (grec.size() - duplicates) << " SVs, " << duplicates << " boundary duplicates removed" << std::endl;
+  htsFile *fp = _ioAttach(hts_open(c.outfile.string().c_str(), "wb"));
+  if (bcf_hdr_write(fp, hdr_out) != 0) std::cerr << "Error: Failed to write BCF header!" << std::endl;
+  uint32_t svcounter = 0;
+  for(uint32_t i = 0; i < grec.size(); ++i) {
+    if (!discard[i]) {
+      std::string id(grec[i].svt);
+      std::string padNumber = boost::lexical_cast<std::string>(svcounter++);
+      padNumber.insert(padNumber.begin(), 8 - padNumber.length(), '0');
+      id += padNumber;
+      bcf_update_id(hdr_out, grec[i].rec, id.c_str());
+      bcf_write1(fp, hdr_out, grec[i].rec);
+    }
+    bcf_destroy(grec[i].rec);
+  }
+  bcf_hdr_destroy(hdr_out);
+  hts_close(fp);
+
+  // Build index
+  bcf_index_build(c.outfile.string().c_str(), 14);
+
+  // End
+  now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] Done." << std::endl;
+  return 0;
+}
+
+int gather(int argc, char **argv) {
+  GatherConfig c;
+
+  // Define generic options
+  int32_t ioThreads = 0;
+  boost::program_options::options_description generic("Generic options");
+  generic.add_options()
+    ("help,?", "show help message")
+    ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
+    ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("sv.bcf"), "Gathered SV BCF output file")
+    ;
+
+  // Define overlap options
+  boost::program_options::options_description overlap("Overlap options");
+  overlap.add_options()
+    ("bp-offset,b", boost::program_options::value<uint32_t>(&c.bpoffset)->default_value(50), "max. breakpoint offset of boundary duplicates")
+    ("rec-overlap,r", boost::program_options::value<float>(&c.recoverlap)->default_value(0.8), "min. reciprocal overlap of boundary duplicates")
+    ;
+
+  // Define hidden options
+  boost::program_options::options_description hidden("Hidden options");
+  hidden.add_options()
+    ("input-file", boost::program_options::value< std::vector<boost::filesystem::path> >(&c.files), "input file")
+    ;
+  boost::program_options::positional_options_description pos_args;
+  pos_args.add("input-file", -1);
+
+  // Set the visibility
+  boost::program_options::options_description cmdline_options;
+  cmdline_options.add(generic).add(overlap).add(hidden);
+  boost::program_options::options_description visible_options;
+  visible_options.add(generic).add(overlap);
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cmdline_options).positional(pos_args).run(), vm);
+  boost::program_options::notify(vm);
+
+  // Check command line arguments
+  if ((vm.count("help")) || (!vm.count("input-file"))) {
+    std::cout << std::endl;
+    std::cout << "Usage: delly " << argv[0] << " [OPTIONS] <shard1.bcf> <shard2.bcf> ..." << std::endl;
+    std::cout << visible_options << "\n";
+    return 0;
+  }
+
+  // Check input BCF files
+  for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
+    htsFile* ifile = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
+    if (!ifile) {
+      std::cerr << "Fail to load " << c.files[file_c].string() << "!" << std::endl;
+      return 1;
+    }
+    bcf_hdr_t* hdr = bcf_hdr_read(ifile);
+    if (hdr == NULL) {
+      std::cerr << "Fail to load header of " << c.files[file_c].string() << "!" << std::endl;
+      bcf_close(ifile);
+      return 1;
+    }
+    bcf_hdr_destroy(hdr);
+    bcf_close(ifile);
+  }
+
+  // Check output directory
+  if (!_outfileValid(c.outfile)) return 1;
+
+  // Shared I/O thread pool
+  _ioPoolInit(ioThreads);
+
+  // Show cmd
+  boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
+  std::cout << "delly ";
+  for(int i=0; i<argc; ++i) { std::cout << argv[i] << ' '; }
+  std::cout << std::endl;
+
+  return gatherRun(c);
+}
+
+}
+
+#endif
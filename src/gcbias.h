@@ -122,18 +122,17 @@ namespace torali
   inline void
   gcBias(TConfig const& c, std::vector< std::vector<ScanWindow> > const& scanCounts, LibraryInfo const& li, std::vector<GcBias>& gcbias, TGCBound& gcbound) {
     // Load bam file
-    samFile* samfile = sam_open(c.bamFile.string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    hts_idx_t* idx = sam_index_load(samfile, c.bamFile.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    samFile* samfile = _hOpen(c.bamFile.string(), c.genome.string(), 0);
+    hts_idx_t* idx = _hIndex(samfile);
+    bam_hdr_t* hdr = _hHeader(c.bamFile.string());
 
     // Parse bam (contig by contig)
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Estimate GC bias" << std::endl;
     boost::progress_display show_progress( hdr->n_targets );
 
-    faidx_t* faiMap = fai_load(c.mapFile.string().c_str());
-    faidx_t* faiRef = fai_load(c.genome.string().c_str());
+    faidx_t* faiMap = _hFaiOpen(c.mapFile.string());
+    faidx_t* faiRef = _hFaiOpen(c.genome.string());
     for (int refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
       ++show_progress;
       if (scanCounts[refIndex].empty()) continue;
@@ -159,7 +158,7 @@ namespace torali
       seqlen = faidx_seq_len(faiRef, tname.c_str());
       if (seqlen == - 1) continue;
       else seqlen = -1;
-      char* ref = faidx_fetch_seq(faiRef, tname.c_str(), 0, faidx_seq_len(faiRef, tname.c_str()), &seqlen);
+      char* ref = _refFetch(c.genome.string(), faiRef, tname.c_str(), 0, faidx_seq_len(faiRef, tname.c_str()), &seqlen);
 
       // Get GC and Mappability
       std::vector<uint16_t> uniqContent(hdr->target_len[refIndex], 0);
@@ -207,7 +206,7 @@ namespace torali
       TCoverage cov(hdr->target_len[refIndex], 0);
       
       // Mate map
-      typedef boost::unordered_map<std::size_t, bool> TMateMap;
+      typedef MateTable<bool> TMateMap;
       TMateMap mateMap;
       
       // Parse BAM
@@ -215,7 +214,7 @@ namespace torali
       bam1_t* rec = bam_init1();
       int32_t lastAlignedPos = 0;
       std::set<std::size_t> lastAlignedPosReads;
-      while (sam_itr_next(samfile, iter, rec) >= 0) {
+      while (_ioItrNext(samfile, iter, rec) >= 0) {
 	if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP)) continue;
 	if ((rec->core.flag & BAM_FPAIRED) && ((rec->core.flag & BAM_FMUNMAP) || (rec->core.tid != rec->core.mtid))) continue;
 	if (rec->core.qual < c.minQual) continue;
@@ -233,13 +232,13 @@ namespace torali
 	    // First read
 	    lastAlignedPosReads.insert(hash_string(bam_get_qname(rec)));
 	    std::size_t hv = hash_pair(rec);
-	    mateMap[hv]= true;
+	    mateMap.insert(hv, true);
 	    continue;
 	  } else {
 	    // Second read
 	    std::size_t hv = hash_pair_mate(rec);
-	    if ((mateMap.find(hv) == mateMap.end()) || (!mateMap[hv])) continue; // Mate discarded
-	    mateMap[hv] = false;
+	    bool mate = false;
+	    if (!mateMap.take(hv, mate)) continue; // Mate discarded
 	  }
 	
 	  // Insert size filter
@@ -331,11 +330,9 @@ namespace torali
       if (gcbias[i].fractionReference > 0) gcbias[i].obsexp = gcbias[i].fractionSample / gcbias[i].fractionReference;
     }
     
-    fai_destroy(faiRef);
-    fai_destroy(faiMap);
-    hts_idx_destroy(idx);
-    sam_close(samfile);
-    bam_hdr_destroy(hdr);
+    _hFaiClose(faiRef);
+    _hFaiClose(faiMap);
+    _hClose(samfile);
   }
 
 }
@@ -50,10 +50,9 @@ namespace torali
     THeader hdr(c.files.size());
     int32_t totalTarget = 0;
     for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
-      hdr[file_c] = sam_hdr_read(samfile[file_c]);
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
+      hdr[file_c] = _hHeader(c.files[file_c].string());
       totalTarget += hdr[file_c]->n_targets;
     }
 
@@ -101,10 +100,10 @@ namespace torali
 
     // Iterate chromosomes
     std::vector<std::string> refProbes(svs.size());
-    faidx_t* fai = fai_load(c.genome.string().c_str());
+    faidx_t* fai = _hFaiOpen(c.genome.string());
     for(int32_t refIndex=0; refIndex < (int32_t) hdr[0]->n_targets; ++refIndex) {
       ++show_progress;
-      char* seq = NULL;
+      RefView seq;
 
       // Reference and consensus probes for this chromosome
       typedef std::vector<Geno> TGenoRegion;
@@ -115,15 +114,11 @@ namespace torali
 	if ((itSV->chr != refIndex) && (itSV->chr2 != refIndex)) continue;
 
 	// Lazy loading of reference sequence
-	if (seq == NULL) {
-	  int32_t seqlen = -1;
-	  std::string tname(hdr[0]->target_name[refIndex]);
-	  seq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr[0]->target_len[refIndex], &seqlen);
-	}
+	if (!seq.loaded()) seq.load(c.genome.string(), fai, hdr[0]->target_name[refIndex]);
 
 	// Set tag alleles
 	if (itSV->chr == refIndex) {
-	  itSV->alleles = _addAlleles(boost::to_upper_copy(std::string(seq + itSV->svStart - 1, seq + itSV->svStart)), std::string(hdr[0]->target_name[itSV->chr2]), *itSV, itSV->svt);
+	  itSV->alleles = _addAlleles(boost::to_upper_copy(seq.slice(itSV->svStart - 1, itSV->svStart)), std::string(hdr[0]->target_name[itSV->chr2]), *itSV, itSV->svt);
 	}
 	if (!itSV->precise) continue;
 
@@ -131,7 +126,7 @@ namespace torali
 	if ((itSV->chr != itSV->chr2) && (itSV->chr2 == refIndex)) {
 	  Breakpoint bp(*itSV);
 	  _initBreakpoint(hdr[0], bp, (int32_t) itSV->consensus.size(), itSV->svt);
-	  refProbes[itSV->id] = _getSVRef(seq, bp, refIndex, itSV->svt);
+	  refProbes[itSV->id] = _getSVRef(&seq, bp, refIndex, itSV->svt);
 	}
 	if (itSV->chr == refIndex) {
 	  Breakpoint bp(*itSV);
@@ -140,7 +135,7 @@ namespace torali
 	    int32_t bufferSpace = std::max((int32_t) ((itSV->consensus.size() - itSV->insLen) / 3), c.minimumFlankSize);
 	    _initBreakpoint(hdr[0], bp, bufferSpace, itSV->svt);
 	  } else _initBreakpoint(hdr[0], bp, (int32_t) itSV->consensus.size(), itSV->svt);
-	  std::string svRefStr = _getSVRef(seq, bp, refIndex, itSV->svt);
+	  std::string svRefStr = _getSVRef(&seq, bp, refIndex, itSV->svt);
 	  
 	  // Find breakpoint to reference
 	  TAlign align;
@@ -206,7 +201,7 @@ namespace torali
 	  gbp[itSV->id].svt = itSV->svt;
 	}
       }
-      if (seq != NULL) free(seq);
+      seq.release();
 
       // Genotype
       // Iterate samples
@@ -248,7 +243,7 @@ namespace torali
 	// Count reads
 	hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, 0, hdr[file_c]->target_len[refIndex]);
 	bam1_t* rec = bam_init1();
-	while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
+	for(RecordPrefetch prefetch(samfile[file_c], iter); prefetch.next(rec) >= 0;) {
 	  // Genotyping only primary alignments
 	  if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP)) continue;
 	  
@@ -474,7 +469,7 @@ namespace torali
       }
     }
     // Clean-up
-    fai_destroy(fai);
+    _hFaiClose(fai);
 
     // Output coverage info
     std::cout << "Coverage distribution (^COV)" << std::endl;
@@ -535,11 +530,7 @@ namespace torali
     }
 
     // Clean-up
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      bam_hdr_destroy(hdr[file_c]);	  
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
      
   
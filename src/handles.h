@@ -0,0 +1,280 @@
+#ifndef HANDLES_H
+#define HANDLES_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdlib>
+
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+#include <htslib/faidx.h>
+
+#include "iopool.h"
+
+
+namespace torali
+{
+
+  #ifndef DELLY_MAX_OPEN
+  #define DELLY_MAX_OPEN 512
+  #endif
+
+  // Record fields decoded by each pass, CRAM skips all other data series
+  #define DELLY_CRAM_COVERAGE (SAM_QNAME | SAM_FLAG | SAM_RNAME | SAM_POS | SAM_MAPQ | SAM_CIGAR | SAM_RNEXT | SAM_PNEXT)
+  #define DELLY_CRAM_INSERT (SAM_FLAG | SAM_RNAME | SAM_POS | SAM_MAPQ | SAM_CIGAR | SAM_RNEXT | SAM_PNEXT | SAM_TLEN)
+  #define DELLY_CRAM_SVSCAN (DELLY_CRAM_COVERAGE | SAM_TLEN | SAM_AUX)
+
+  // CRAM decoding profile of a pass, MD/NM tags are never re-generated
+  inline void
+  _cramProfile(samFile* fp, int const fields) {
+    if ((fp == NULL) || (hts_get_format(fp)->format != cram)) return;
+    hts_set_opt(fp, CRAM_OPT_REQUIRED_FIELDS, fields);
+    hts_set_opt(fp, CRAM_OPT_DECODE_MD, 0);
+  }
+
+  // Open alignment handle, CRAM indices belong to a single handle
+  struct PooledHandle {
+    samFile* fp;
+    hts_idx_t* idx;
+    int32_t fields;
+    bool ownIdx;
+    std::string file;
+    std::string genome;
+
+    PooledHandle() : fp(NULL), idx(NULL), fields(0), ownIdx(false) {}
+  };
+
+  // Header and BAM index, loaded once per file
+  struct PooledFile {
+    hts_idx_t* idx;
+    bam_hdr_t* hdr;
+
+    PooledFile() : idx(NULL), hdr(NULL) {}
+  };
+
+  // Process-wide pool of alignment handles, indices, headers and reference indices borrowed by all stages
+  struct HandlePool {
+    int32_t maxOpen;
+    int32_t nopen;
+    std::map<std::string, PooledFile> files;
+    std::vector<PooledHandle> idle;
+    std::map<samFile*, PooledHandle> borrowed;
+    std::vector<std::pair<std::string, faidx_t*> > idleFai;
+    std::map<faidx_t*, std::string> borrowedFai;
+
+    HandlePool() : maxOpen(DELLY_MAX_OPEN), nopen(0) {}
+  };
+
+  inline HandlePool&
+  _hPool() {
+    static HandlePool pool;
+    return pool;
+  }
+
+  inline void
+  _hDestroy(HandlePool& hp, PooledHandle& ph) {
+    if (ph.ownIdx) hts_idx_destroy(ph.idx);
+    sam_close(ph.fp);
+    --hp.nopen;
+  }
+
+  // Borrow a handle with the given reference and CRAM fields (0: all), the least recently used idle handle is closed at the open-file limit
+  inline samFile*
+  _hOpen(std::string const& file, std::string const& genome, int32_t const fields) {
+    samFile* fp = NULL;
+    bool reserved = false;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      for(int32_t i = (int32_t) hp.idle.size() - 1; i >= 0; --i) {
+	// Only CRAM handles have a decoding profile
+	if ((hp.idle[i].file == file) && (hp.idle[i].genome == genome) && ((!hp.idle[i].ownIdx) || (hp.idle[i].fields == fields))) {
+	  fp = hp.idle[i].fp;
+	  hp.borrowed[fp] = hp.idle[i];
+	  hp.idle.erase(hp.idle.begin() + i);
+	  break;
+	}
+      }
+      if (fp == NULL) {
+	if ((hp.nopen >= hp.maxOpen) && (!hp.idle.empty())) {
+	  _hDestroy(hp, hp.idle.front());
+	  hp.idle.erase(hp.idle.begin());
+	}
+	++hp.nopen;
+	reserved = true;
+      }
+    }
+    if (!reserved) return fp;
+
+    // Open, header and index I/O run outside of the pool lock
+    PooledHandle ph;
+    ph.fp = _ioAttach(sam_open(file.c_str(), "r"));
+    bam_hdr_t* hdr = NULL;
+    if (ph.fp != NULL) {
+      if (!genome.empty()) hts_set_fai_filename(ph.fp, genome.c_str());
+      if (fields) _cramProfile(ph.fp, fields);
+      ph.fields = fields;
+      ph.file = file;
+      ph.genome = genome;
+      hdr = sam_hdr_read(ph.fp);
+      // The name hash is built on first lookup, build it before the header is shared across threads
+      if ((hdr != NULL) && (hdr->n_targets)) bam_name2id(hdr, hdr->target_name[0]);
+      ph.ownIdx = (hts_get_format(ph.fp)->format == cram);
+      if (ph.ownIdx) ph.idx = sam_index_load(ph.fp, file.c_str());
+      else {
+	bool loaded = false;
+#pragma omp critical (handlepool)
+	loaded = (_hPool().files[file].idx != NULL);
+	if (!loaded) ph.idx = sam_index_load(ph.fp, file.c_str());
+      }
+    }
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      if (ph.fp == NULL) --hp.nopen;
+      else {
+	PooledFile& pf = hp.files[file];
+	if (pf.hdr == NULL) pf.hdr = hdr;
+	else if (hdr != NULL) bam_hdr_destroy(hdr);
+	if (!ph.ownIdx) {
+	  // Concurrent first opens may load the same BAM index twice
+	  if (pf.idx == NULL) pf.idx = ph.idx;
+	  else if (ph.idx != NULL) hts_idx_destroy(ph.idx);
+	  ph.idx = pf.idx;
+	}
+	fp = ph.fp;
+	hp.borrowed[fp] = ph;
+      }
+    }
+    return fp;
+  }
+
+  // Index of a borrowed handle, NULL if the file has no index (retried once the index has been built)
+  inline hts_idx_t*
+  _hIndex(samFile* fp) {
+    hts_idx_t* idx = NULL;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      std::map<samFile*, PooledHandle>::iterator it = hp.borrowed.find(fp);
+      if (it != hp.borrowed.end()) {
+	PooledHandle& ph = it->second;
+	if (!ph.ownIdx) {
+	  PooledFile& pf = hp.files[ph.file];
+	  if (pf.idx == NULL) pf.idx = sam_index_load(ph.fp, ph.file.c_str());
+	  ph.idx = pf.idx;
+	} else if (ph.idx == NULL) ph.idx = sam_index_load(ph.fp, ph.file.c_str());
+	idx = ph.idx;
+      }
+    }
+    return idx;
+  }
+
+  // Return a borrowed handle, handles above the open-file limit are closed
+  inline void
+  _hClose(samFile* fp) {
+    if (fp == NULL) return;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      std::map<samFile*, PooledHandle>::iterator it = hp.borrowed.find(fp);
+      if (it != hp.borrowed.end()) {
+	if (hp.nopen > hp.maxOpen) _hDestroy(hp, it->second);
+	else hp.idle.push_back(it->second);
+	hp.borrowed.erase(it);
+      }
+    }
+  }
+
+  // Header of an alignment file, owned by the pool
+  inline bam_hdr_t*
+  _hHeader(std::string const& file) {
+    bam_hdr_t* hdr = NULL;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      std::map<std::string, PooledFile>::iterator it = hp.files.find(file);
+      if (it != hp.files.end()) hdr = it->second.hdr;
+    }
+    if (hdr == NULL) {
+      samFile* fp = _hOpen(file, std::string(), 0);
+      if (fp != NULL) {
+#pragma omp critical (handlepool)
+	hdr = _hPool().files[file].hdr;
+      }
+      _hClose(fp);
+    }
+    return hdr;
+  }
+
+  // Reference index handles, faidx_fetch_seq is not thread-safe so each borrower gets its own
+  inline faidx_t*
+  _hFaiOpen(std::string const& file) {
+    faidx_t* fai = NULL;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      for(int32_t i = (int32_t) hp.idleFai.size() - 1; i >= 0; --i) {
+	if (hp.idleFai[i].first == file) {
+	  fai = hp.idleFai[i].second;
+	  hp.idleFai.erase(hp.idleFai.begin() + i);
+	  break;
+	}
+      }
+    }
+    if (fai == NULL) {
+      fai = fai_load(file.c_str());
+      if (fai != NULL) {
+#pragma omp critical (handlepool)
+	_hPool().borrowedFai[fai] = file;
+      }
+    }
+    return fai;
+  }
+
+  inline void
+  _hFaiClose(faidx_t* fai) {
+    if (fai == NULL) return;
+#pragma omp critical (handlepool)
+    {
+      HandlePool& hp = _hPool();
+      std::map<faidx_t*, std::string>::iterator it = hp.borrowedFai.find(fai);
+      if (it != hp.borrowedFai.end()) {
+	hp.idleFai.push_back(std::make_pair(it->second, fai));
+	hp.borrowedFai.erase(it);
+      } else fai_destroy(fai);
+    }
+  }
+
+  // Close all idle handles, borrowed handles are left to their borrowers
+  inline void
+  _hPoolFinish() {
+    HandlePool& hp = _hPool();
+    for(uint32_t i = 0; i < hp.idle.size(); ++i) _hDestroy(hp, hp.idle[i]);
+    hp.idle.clear();
+    for(std::map<std::string, PooledFile>::iterator it = hp.files.begin(); it != hp.files.end(); ++it) {
+      if (it->second.idx != NULL) hts_idx_destroy(it->second.idx);
+      if (it->second.hdr != NULL) bam_hdr_destroy(it->second.hdr);
+    }
+    hp.files.clear();
+    for(uint32_t i = 0; i < hp.idleFai.size(); ++i) fai_destroy(hp.idleFai[i].second);
+    hp.idleFai.clear();
+  }
+
+  // Set the open-file limit, called after _ioPoolInit so that handles are closed before the I/O pool
+  inline void
+  _hPoolInit(int32_t const maxOpen) {
+    HandlePool& hp = _hPool();
+    if (maxOpen > 0) hp.maxOpen = maxOpen;
+    static bool registered = false;
+    if (!registered) {
+      std::atexit(_hPoolFinish);
+      registered = true;
+    }
+  }
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+
+namespace torali
+{
+
+  #ifndef DELLY_HASH_SEED
+  #define DELLY_HASH_SEED 0x2d358dccaa6c78a5ULL
+  #endif
+
+  #define DELLY_HASH_P0 0xa0761d6478bd642fULL
+  #define DELLY_HASH_P1 0xe7037ed1a0b428dbULL
+
+  // 64x64->128 bit multiply folded to 64 bits, computed on 32-bit halves to stay within ISO C++
+  inline uint64_t
+  _hashMum(uint64_t const a, uint64_t const b) {
+    uint64_t ha = a >> 32;
+    uint64_t hb = b >> 32;
+    uint64_t la = (uint32_t) a;
+    uint64_t lb = (uint32_t) b;
+    uint64_t rh = ha * hb;
+    uint64_t rm0 = ha * lb;
+    uint64_t rm1 = hb * la;
+    uint64_t rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = (t < rl);
+    uint64_t lo = t + (rm1 << 32);
+    carry += (lo < t);
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    return hi ^ lo;
+  }
+
+  inline uint64_t
+  _hashRead8(unsigned char const* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  inline uint64_t
+  _hashRead4(unsigned char const* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+  }
+
+  // Word-wise 64-bit hash of a byte string (wyhash-style)
+  inline uint64_t
+  hash_bytes(void const* key, std::size_t const len, uint64_t seed) {
+    unsigned char const* p = (unsigned char const*) key;
+    seed ^= DELLY_HASH_P0;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (len <= 16) {
+      if (len >= 4) {
+	std::size_t off = (len >> 3) << 2;
+	a = (_hashRead4(p) << 32) | _hashRead4(p + off);
+	b = (_hashRead4(p + len - 4) << 32) | _hashRead4(p + len - 4 - off);
+      } else if (len > 0) {
+	a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+      }
+    } else {
+      std::size_t i = len;
+      for(; i > 16; i -= 16, p += 16) seed = _hashMum(_hashRead8(p) ^ DELLY_HASH_P1, _hashRead8(p + 8) ^ seed);
+      a = _hashRead8(p + i - 16);
+      b = _hashRead8(p + i - 8);
+    }
+    return _hashMum(DELLY_HASH_P1 ^ len, _hashMum(a ^ DELLY_HASH_P1, b ^ seed));
+  }
+
+  // Fold a 64-bit value into a hash, the order of values matters
+  inline uint64_t
+  hash_mix(uint64_t const h, uint64_t const v) {
+    return _hashMum(h ^ DELLY_HASH_P0, v ^ DELLY_HASH_P1);
+  }
+
+  inline uint64_t
+  hash_string(char const* s) {
+    return hash_bytes(s, std::strlen(s), DELLY_HASH_SEED);
+  }
+
+  // Reference and position packed into one word
+  inline uint64_t
+  hash_pos(int32_t const tid, int32_t const pos) {
+    return ((uint64_t) (uint32_t) tid << 32) | (uint32_t) pos;
+  }
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "hash.h"
+
+using namespace torali;
+
+// Read-name hash of earlier delly versions, 32-bit
+inline unsigned
+legacyHash(char const* s) {
+  unsigned h = 37;
+  while (*s) {
+    h = (h * 54059) ^ (s[0] * 76963);
+    s++;
+  }
+  return h;
+}
+
+// Unique Illumina-style read name of the i-th read, lane:tile:x:y
+inline int
+readName(uint64_t const i, char* buf) {
+  uint64_t y = i % 100000;
+  uint64_t x = (i / 100000) % 40000;
+  uint64_t tile = (i / 4000000000ULL) % 10000;
+  uint64_t lane = 1 + (i / 40000000000000ULL);
+  return snprintf(buf, 64, "A00123:587:HV2MTDSXY:%llu:%llu:%llu:%llu", (unsigned long long) lane, (unsigned long long) (1101 + tile), (unsigned long long) x, (unsigned long long) y);
+}
+
+// Equal adjacent values of a sorted vector
+template<typename TValue>
+inline uint64_t
+collisions(std::vector<TValue>& h) {
+  std::sort(h.begin(), h.end());
+  uint64_t col = 0;
+  for(std::size_t i = 1; i < h.size(); ++i) {
+    if (h[i] == h[i-1]) ++col;
+  }
+  return col;
+}
+
+int main(int argc, char **argv) {
+  // Number of read names and hash partitions, each pass keeps the hashes of one partition
+  uint64_t n = 1000000000ULL;
+  uint32_t passes = 16;
+  if (argc > 1) n = strtoull(argv[1], NULL, 10);
+  if (argc > 2) passes = std::max(1, atoi(argv[2]));
+  char buf[64];
+
+  // Throughput on a block of pre-formatted names
+  uint64_t const blockSize = 1000000;
+  uint32_t const rounds = 20;
+  std::vector<char> block(blockSize * 64);
+  for(uint64_t i = 0; i < blockSize; ++i) readName(i, &block[i * 64]);
+  uint64_t sink = 0;
+  boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::local_time();
+  for(uint32_t r = 0; r < rounds; ++r) {
+    for(uint64_t i = 0; i < blockSize; ++i) sink ^= legacyHash(&block[i * 64]);
+  }
+  boost::posix_time::ptime t1 = boost::posix_time::microsec_clock::local_time();
+  for(uint32_t r = 0; r < rounds; ++r) {
+    for(uint64_t i = 0; i < blockSize; ++i) sink ^= hash_string(&block[i * 64]);
+  }
+  boost::posix_time::ptime t2 = boost::posix_time::microsec_clock::local_time();
+  double total = (double) blockSize * rounds;
+  std::cout << "Legacy32=" << ((t1 - t0).total_microseconds() * 1000.0 / total) << "ns/name,Hash64=" << ((t2 - t1).total_microseconds() * 1000.0 / total) << "ns/name (" << (sink & 1) << ")" << std::endl;
+
+  // Collisions
+  uint64_t col32 = 0;
+  uint64_t col64 = 0;
+  for(uint32_t p = 0; p < passes; ++p) {
+    std::vector<uint32_t> h32;
+    std::vector<uint64_t> h64;
+    h32.reserve(n / passes + n / (passes * 10) + 1);
+    h64.reserve(n / passes + n / (passes * 10) + 1);
+    for(uint64_t i = 0; i < n; ++i) {
+      readName(i, buf);
+      uint32_t l = legacyHash(buf);
+      if (l % passes == p) h32.push_back(l);
+      uint64_t h = hash_string(buf);
+      if (h % passes == p) h64.push_back(h);
+    }
+    col32 += collisions(h32);
+    col64 += collisions(h64);
+    std::cout << "Pass " << (p + 1) << "/" << passes << ",Legacy32Collisions=" << col32 << ",Hash64Collisions=" << col64 << std::endl;
+  }
+  double expected = (double) n * (double) n / 36893488147419103232.0;
+  std::cout << "Names=" << n << ",Legacy32Collisions=" << col32 << ",Hash64Collisions=" << col64 << ",Hash64Expected=" << expected << std::endl;
+  return 0;
+}
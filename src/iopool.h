@@ -0,0 +1,199 @@
+#ifndef IOPOOL_H
+#define IOPOOL_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <time.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+#include <htslib/vcf.h>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+
+namespace torali
+{
+
+  // Process-wide htslib thread pool shared by all BAM/CRAM/BCF handles
+  struct IOPool {
+    int32_t nthreads;
+    int32_t prefetch;
+    htsThreadPool tp;
+    std::vector<uint64_t> waitNs;
+    boost::posix_time::ptime start;
+
+    IOPool() : nthreads(0), prefetch(0) {
+      tp.pool = NULL;
+      tp.qsize = 0;
+    }
+  };
+
+  // Wait times are padded to one cache line per compute thread
+  #ifndef IOPOOL_STRIDE
+  #define IOPOOL_STRIDE 8
+  #endif
+
+  inline IOPool&
+  _ioPool() {
+    static IOPool pool;
+    return pool;
+  }
+
+  // Attach the shared pool to an open handle, BGZF and CRAM (de-)compression then run on the pool
+  template<typename TFile>
+  inline TFile*
+  _ioAttach(TFile* fp) {
+    IOPool& io = _ioPool();
+    if ((fp != NULL) && (io.tp.pool != NULL)) hts_set_thread_pool(fp, &io.tp);
+    return fp;
+  }
+
+  inline uint64_t
+  _ioNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+  }
+
+  inline void
+  _ioAddWait(uint64_t const ns) {
+    IOPool& io = _ioPool();
+    std::size_t slot = 0;
+#ifdef OPENMP
+    slot = (omp_get_thread_num() * IOPOOL_STRIDE) % io.waitNs.size();
+#endif
+    io.waitNs[slot] += ns;
+  }
+
+  // Fetch the next record, the time the compute thread waits for decoded records is tracked if the pool is on
+  inline int
+  _ioItrNext(samFile* fp, hts_itr_t* iter, bam1_t* rec) {
+    if (_ioPool().tp.pool == NULL) return sam_itr_next(fp, iter, rec);
+    uint64_t t0 = _ioNowNs();
+    int ret = sam_itr_next(fp, iter, rec);
+    _ioAddWait(_ioNowNs() - t0);
+    return ret;
+  }
+
+  inline int
+  _ioBcfRead(htsFile* fp, bcf_hdr_t const* hdr, bcf1_t* rec) {
+    if (_ioPool().tp.pool == NULL) return bcf_read(fp, hdr, rec);
+    uint64_t t0 = _ioNowNs();
+    int ret = bcf_read(fp, hdr, rec);
+    _ioAddWait(_ioNowNs() - t0);
+    return ret;
+  }
+
+  // Spool a coordinate-sorted alignment stream (e.g., stdin) to BAM, the CSI index is built while writing
+  inline bool
+  _ioSpoolStream(std::string const& infile, std::string const& outfile) {
+    samFile* in = _ioAttach(sam_open(infile.c_str(), "r"));
+    if (in == NULL) {
+      std::cerr << "Fail to open alignment stream " << infile << std::endl;
+      return false;
+    }
+    bam_hdr_t* hdr = sam_hdr_read(in);
+    if (hdr == NULL) {
+      std::cerr << "Fail to read header of alignment stream " << infile << std::endl;
+      sam_close(in);
+      return false;
+    }
+    std::string idxfile = outfile + ".csi";
+    samFile* out = _ioAttach(sam_open(outfile.c_str(), "wb"));
+    bool ok = true;
+    if ((out == NULL) || (sam_hdr_write(out, hdr) != 0) || (sam_idx_init(out, hdr, 14, idxfile.c_str()) != 0)) {
+      std::cerr << "Fail to write " << outfile << std::endl;
+      ok = false;
+    } else {
+      bam1_t* rec = bam_init1();
+      int ret = 0;
+      while ((ret = sam_read1(in, hdr, rec)) >= 0) {
+	// Writing fails if the index sees unsorted positions
+	if (sam_write1(out, hdr, rec) < 0) {
+	  std::cerr << "Alignment stream is not coordinate-sorted or the spool file is not writable: " << outfile << std::endl;
+	  ok = false;
+	  break;
+	}
+      }
+      if ((ok) && (ret < -1)) {
+	std::cerr << "Alignment stream is truncated: " << infile << std::endl;
+	ok = false;
+      }
+      bam_destroy1(rec);
+      if ((ok) && (sam_idx_save(out) != 0)) {
+	std::cerr << "Fail to write index " << idxfile << std::endl;
+	ok = false;
+      }
+    }
+    if (out != NULL) sam_close(out);
+    bam_hdr_destroy(hdr);
+    sam_close(in);
+    return ok;
+  }
+
+  // Removes a spooled alignment stream and its index when going out of scope
+  struct IOSpool {
+    std::string file;
+
+    ~IOSpool() {
+      if (file.empty()) return;
+      std::remove(file.c_str());
+      std::remove((file + ".csi").c_str());
+    }
+  };
+
+  // Report decoding vs. compute time and destroy the pool, all handles need to be closed
+  inline void
+  _ioPoolFinish() {
+    IOPool& io = _ioPool();
+    if (io.tp.pool == NULL) return;
+    boost::posix_time::time_duration wall = boost::posix_time::microsec_clock::local_time() - io.start;
+    double wallSec = wall.total_microseconds() / 1000000.0;
+    double waitSec = 0;
+    for(uint32_t i = 0; i < io.waitNs.size(); i += IOPOOL_STRIDE) waitSec += io.waitNs[i] / 1000000000.0;
+    // Compute time is the wall time of all compute threads minus their decode wait
+    double busySec = wallSec * (io.waitNs.size() / IOPOOL_STRIDE);
+    std::cout << "I/O statistics: IOThreads=" << io.nthreads << ",ComputeThreads=" << (io.waitNs.size() / IOPOOL_STRIDE) << ",WallTime=" << wallSec << "s,DecodeWait=" << waitSec << "s,Compute=" << std::max(0.0, busySec - waitSec) << "s" << std::endl;
+    hts_tpool_destroy(io.tp.pool);
+    io.tp.pool = NULL;
+    io.nthreads = 0;
+  }
+
+  // Record batches decoded ahead of each scan loop by a producer thread (0: decode on the compute thread)
+  inline void
+  _ioPrefetchInit(int32_t const batches) {
+    _ioPool().prefetch = std::max(0, batches);
+  }
+
+  // Create the pool once per process, statistics are reported at exit
+  inline void
+  _ioPoolInit(int32_t const nthreads) {
+    IOPool& io = _ioPool();
+    if ((nthreads <= 0) || (io.tp.pool != NULL)) return;
+    io.tp.pool = hts_tpool_init(nthreads);
+    if (io.tp.pool == NULL) {
+      std::cerr << "Warning: Failed to create the I/O thread pool!" << std::endl;
+      return;
+    }
+    io.nthreads = nthreads;
+    int32_t computeThreads = 1;
+#ifdef OPENMP
+    computeThreads = omp_get_max_threads();
+#endif
+    io.waitNs.assign(computeThreads * IOPOOL_STRIDE, 0);
+    io.start = boost::posix_time::microsec_clock::local_time();
+    std::atexit(_ioPoolFinish);
+  }
+
+}
+
+#endif
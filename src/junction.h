@@ -52,29 +52,169 @@ namespace torali
     int32_t seqpos;
     uint16_t qual;
     
+    Junction() {}
     Junction(bool const fw, bool const cl, int32_t const idx, int32_t const rst, int32_t const r, int32_t const s, uint16_t const qval) : forward(fw), scleft(cl), refidx(idx), rstart(rst), refpos(r), seqpos(s), qual(qval) {}
   };
 
 
+  // Junction at the given reference and sequence pointer, false if the sequence pointer is beyond the read
+  inline bool
+  _readJunction(bam1_t* rec, int32_t const rp, int32_t const sp, bool const scleft, Junction& jct) {
+    int32_t seqlen = readLength(rec);
+    if (sp > seqlen) return false;
+    int32_t readStart = rec->core.pos;
+    if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) readStart = -1;
+    if (rec->core.flag & BAM_FREVERSE) jct = Junction(false, scleft, rec->core.tid, readStart, rp, seqlen - sp, rec->core.qual);
+    else jct = Junction(true, scleft, rec->core.tid, readStart, rp, sp, rec->core.qual);
+    return true;
+  }
+
   template<typename TReadBp>
   inline void
     _insertJunction(TReadBp& readBp, std::size_t const seed, bam1_t* rec, int32_t const rp, int32_t const sp, bool const scleft) {
-    bool fw = true;
-    if (rec->core.flag & BAM_FREVERSE) fw = false;
-    int32_t readStart = rec->core.pos;
-    if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) readStart = -1;
     typedef typename TReadBp::mapped_type TJunctionVector;
+    Junction jct;
+    if (!_readJunction(rec, rp, sp, scleft, jct)) return;
     typename TReadBp::iterator it = readBp.find(seed);
-    int32_t seqlen = readLength(rec);
-    if (sp <= seqlen) {
-      if (rec->core.flag & BAM_FREVERSE) {
-	if (it != readBp.end()) it->second.push_back(Junction(fw, scleft, rec->core.tid, readStart, rp, seqlen - sp, rec->core.qual));
-	else readBp.insert(std::make_pair(seed, TJunctionVector(1, Junction(fw, scleft, rec->core.tid, readStart, rp, seqlen - sp, rec->core.qual))));
+    if (it != readBp.end()) it->second.push_back(jct);
+    else readBp.insert(std::make_pair(seed, TJunctionVector(1, jct)));
+  }
+
+  // Any supplementary alignment (SA tag) on another chromosome?
+  inline bool
+  _interChrSA(uint8_t* saptr, char const* chrName) {
+    char const* sa = bam_aux2Z(saptr);
+    if (sa == NULL) return false;
+    std::size_t namelen = strlen(chrName);
+    while (*sa != '\0') {
+      char const* sep = strchr(sa, ',');
+      if (sep == NULL) break;
+      if (((std::size_t) (sep - sa) != namelen) || (strncmp(sa, chrName, namelen) != 0)) return true;
+      sa = strchr(sep, ';');
+      if (sa == NULL) break;
+      ++sa;
+    }
+    return false;
+  }
+
+  // Junctions of the split alignments listed in the SA tag (rname,pos,strand,CIGAR,mapQ,NM;)
+  template<typename TConfig, typename TValidRegion, typename TJunctionVector>
+  inline void
+  _saJunctions(TConfig const& c, TValidRegion const& validRegions, bam_hdr_t const* hdr, uint8_t* saptr, TJunctionVector& jv) {
+    typedef typename TValidRegion::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
+    typedef std::pair<char, uint32_t> TCigarOp;
+
+    char const* sa = bam_aux2Z(saptr);
+    if (sa == NULL) return;
+    std::vector<TCigarOp> cigar;
+    while (*sa != '\0') {
+      char const* sep = strchr(sa, ',');
+      if (sep == NULL) break;
+      std::string chrName(sa, sep);
+      char* endptr = NULL;
+      int32_t pos = strtol(sep + 1, &endptr, 10) - 1;
+      if ((*endptr != ',') || (endptr[1] == '\0') || (endptr[2] != ',')) break;
+      bool forward = (endptr[1] != '-');
+      char const* cg = endptr + 3;
+      cigar.clear();
+      int32_t seqlen = 0;
+      int32_t reflen = 0;
+      while ((*cg >= '0') && (*cg <= '9')) {
+	uint32_t oplen = strtoul(cg, &endptr, 10);
+	cigar.push_back(std::make_pair(*endptr, oplen));
+	if ((*endptr == 'M') || (*endptr == '=') || (*endptr == 'X')) {
+	  seqlen += oplen;
+	  reflen += oplen;
+	} else if ((*endptr == 'I') || (*endptr == 'S') || (*endptr == 'H')) seqlen += oplen;
+	else if ((*endptr == 'D') || (*endptr == 'N')) reflen += oplen;
+	cg = endptr + 1;
+      }
+      if (*cg != ',') break;
+      int32_t qual = strtol(cg + 1, &endptr, 10);
+      sa = strchr(endptr, ';');
+      if (sa != NULL) ++sa;
+
+      // Same filters as for the supplementary record itself
+      int32_t tid = bam_name2id(const_cast<bam_hdr_t*>(hdr), chrName.c_str());
+      if ((tid >= 0) && (qual >= c.minMapQual) && (boost::icl::intersects(validRegions[tid], TIVal::right_open(pos, pos + std::max(reflen, 1))))) {
+	int32_t rp = pos;
+	int32_t sp = 0;
+	for(uint32_t i = 0; i < cigar.size(); ++i) {
+	  uint32_t oplen = cigar[i].second;
+	  if ((cigar[i].first == 'M') || (cigar[i].first == '=') || (cigar[i].first == 'X')) {
+	    sp += oplen;
+	    rp += oplen;
+	  } else if (cigar[i].first == 'D') {
+	    if (oplen > c.minRefSep) jv.push_back(Junction(forward, false, tid, -1, rp, forward ? sp : seqlen - sp, qual));
+	    rp += oplen;
+	    if (oplen > c.minRefSep) jv.push_back(Junction(forward, true, tid, -1, rp, forward ? sp : seqlen - sp, qual));
+	  } else if (cigar[i].first == 'I') {
+	    if (oplen > c.minRefSep) jv.push_back(Junction(forward, false, tid, -1, rp, forward ? sp : seqlen - sp, qual));
+	    sp += oplen;
+	    if (oplen > c.minRefSep) jv.push_back(Junction(forward, true, tid, -1, rp, forward ? sp : seqlen - sp, qual));
+	  } else if ((cigar[i].first == 'S') || (cigar[i].first == 'H')) {
+	    int32_t finalsp = sp;
+	    bool scleft = false;
+	    if (sp == 0) {
+	      finalsp += oplen;
+	      scleft = true;
+	    }
+	    sp += oplen;
+	    if (oplen > c.minClip) jv.push_back(Junction(forward, scleft, tid, -1, rp, forward ? finalsp : seqlen - finalsp, qual));
+	  } else if (cigar[i].first == 'N') rp += oplen;
+	}
+      }
+      if (sa == NULL) break;
+    }
+  }
+
+  // Supplementary alignment that stands in for its primary alignment beyond the shard margin. The primary alignment is the first SA entry,
+  // of several supplementary alignments in the scanned regions only the leftmost one is used.
+  template<typename TConfig, typename TValidRegion>
+  inline bool
+  _ownSplitAlignment(TConfig const& c, bam_hdr_t const* hdr, TValidRegion const& validRegions, TValidRegion const& scanRegions, bam1_t const* rec) {
+    typedef typename TValidRegion::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
+
+    if (!(rec->core.flag & BAM_FSUPPLEMENTARY)) return false;
+    uint8_t* saptr = bam_aux_get(rec, "SA");
+    if (saptr == NULL) return false;
+    char const* sa = bam_aux2Z(saptr);
+    if (sa == NULL) return false;
+    bool primary = true;
+    while (*sa != '\0') {
+      char const* sep = strchr(sa, ',');
+      if (sep == NULL) break;
+      std::string chrName(sa, sep);
+      char* endptr = NULL;
+      int32_t pos = strtol(sep + 1, &endptr, 10) - 1;
+      if ((*endptr != ',') || (endptr[1] == '\0') || (endptr[2] != ',')) break;
+      char const* cg = endptr + 3;
+      int32_t reflen = 0;
+      while ((*cg >= '0') && (*cg <= '9')) {
+	uint32_t oplen = strtoul(cg, &endptr, 10);
+	if ((*endptr == 'M') || (*endptr == '=') || (*endptr == 'X') || (*endptr == 'D') || (*endptr == 'N')) reflen += oplen;
+	cg = endptr + 1;
+      }
+      if (*cg != ',') break;
+      int32_t qual = strtol(cg + 1, &endptr, 10);
+      int32_t tid = bam_name2id(const_cast<bam_hdr_t*>(hdr), chrName.c_str());
+      if (tid < 0) {
+	if (primary) return false;
       } else {
-	if (it != readBp.end()) it->second.push_back(Junction(fw, scleft, rec->core.tid, readStart, rp, sp, rec->core.qual));
-	else readBp.insert(std::make_pair(seed, TJunctionVector(1, Junction(fw, scleft, rec->core.tid, readStart, rp, sp, rec->core.qual))));
+	TIVal ival = TIVal::right_open(pos, pos + std::max(reflen, 1));
+	if (primary) {
+	  // Primary alignment is scanned itself, excluded or filtered
+	  if ((boost::icl::intersects(scanRegions[tid], ival)) || (!boost::icl::intersects(validRegions[tid], ival)) || (qual < c.minMapQual)) return false;
+	} else if ((boost::icl::intersects(scanRegions[tid], ival)) && ((tid < rec->core.tid) || ((tid == rec->core.tid) && (pos < rec->core.pos)))) return false;
       }
+      primary = false;
+      sa = strchr(endptr, ';');
+      if (sa == NULL) break;
+      ++sa;
     }
+    return !primary;
   }
 
   template<typename TJunction>
@@ -286,11 +426,10 @@ namespace torali
     TSamFile samfile(c.files.size());
     TIndex idx(c.files.size());
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
     }
-    bam_hdr_t* hdr = sam_hdr_read(samfile[0]);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
     
     // Parse genome chr-by-chr
     boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
@@ -305,106 +444,107 @@ namespace torali
       // Collect reads from all samples
       for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
 	// Read alignments
-	for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); vRIt != validRegions[refIndex].end(); ++vRIt) {
-	  hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, vRIt->lower(), vRIt->upper());
-	  bam1_t* rec = bam_init1();
-	  while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
-
-	    // Keep secondary alignments
-	    if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP)) continue;
-	    if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
-
-	    std::size_t seed = hash_lr(rec);
-	    //std::cerr << bam_get_qname(rec) << '\t' << seed << std::endl;
-	    uint32_t rp = rec->core.pos; // reference pointer
-	    uint32_t sp = 0; // sequence pointer
+	hts_itr_t* iter = _validRegionsIter(idx[file_c], hdr, refIndex, validRegions[refIndex], 0, hdr->target_len[refIndex]);
+	if (iter == NULL) continue;
+	ValidRegionCursor<TChrIntervals> cursor(validRegions[refIndex]);
+	bam1_t* rec = bam_init1();
+	for(RecordPrefetch prefetch(samfile[file_c], iter); prefetch.next(rec) >= 0;) {
+	  if (cursor.anchor(rec) < 0) continue;
+
+	  // Keep secondary alignments
+	  if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP)) continue;
+	  if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
+
+	  std::size_t seed = hash_lr(rec);
+	  //std::cerr << bam_get_qname(rec) << '\t' << seed << std::endl;
+	  uint32_t rp = rec->core.pos; // reference pointer
+	  uint32_t sp = 0; // sequence pointer
 	    
-	    // Parse the CIGAR
-	    uint32_t* cigar = bam_get_cigar(rec);
-	    for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
-	      if ((bam_cigar_op(cigar[i]) == BAM_CMATCH) || (bam_cigar_op(cigar[i]) == BAM_CEQUAL) || (bam_cigar_op(cigar[i]) == BAM_CDIFF)) {
-		sp += bam_cigar_oplen(cigar[i]);
-		rp += bam_cigar_oplen(cigar[i]);
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
-		rp += bam_cigar_oplen(cigar[i]);
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) { // Try look-ahead
-		  uint32_t spOrig = sp;
-		  uint32_t rpTmp = rp;
-		  uint32_t spTmp = sp;
-		  uint32_t dlen = bam_cigar_oplen(cigar[i]);
-		  for (std::size_t j = i + 1; j < rec->core.n_cigar; ++j) {
-		    if ((bam_cigar_op(cigar[j]) == BAM_CMATCH) || (bam_cigar_op(cigar[j]) == BAM_CEQUAL) || (bam_cigar_op(cigar[j]) == BAM_CDIFF)) {
-		      spTmp += bam_cigar_oplen(cigar[j]);
-		      rpTmp += bam_cigar_oplen(cigar[j]);
-		      if ((double) (spTmp - sp) / (double) (dlen + (rpTmp - rp)) > c.indelExtension) break;
-		    } else if (bam_cigar_op(cigar[j]) == BAM_CDEL) {
-		      rpTmp += bam_cigar_oplen(cigar[j]);
-		      if (bam_cigar_oplen(cigar[j]) > c.minRefSep) {
-			// Extend deletion
-			dlen += (rpTmp - rp);
-			rp = rpTmp;
-			sp = spTmp;
-			i = j;
-		      }
-		    } else if (bam_cigar_op(cigar[j]) == BAM_CINS) {
-		      if (bam_cigar_oplen(cigar[j]) > c.minRefSep) break; // No extension
-		      spTmp += bam_cigar_oplen(cigar[j]);
-		    } else break; // No extension
-		  }
-		  _insertJunction(readBp, seed, rec, rp, spOrig, true);
+	  // Parse the CIGAR
+	  uint32_t* cigar = bam_get_cigar(rec);
+	  for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
+	    if ((bam_cigar_op(cigar[i]) == BAM_CMATCH) || (bam_cigar_op(cigar[i]) == BAM_CEQUAL) || (bam_cigar_op(cigar[i]) == BAM_CDIFF)) {
+	      sp += bam_cigar_oplen(cigar[i]);
+	      rp += bam_cigar_oplen(cigar[i]);
+	    } else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
+	      if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
+	      rp += bam_cigar_oplen(cigar[i]);
+	      if (bam_cigar_oplen(cigar[i]) > c.minRefSep) { // Try look-ahead
+		uint32_t spOrig = sp;
+		uint32_t rpTmp = rp;
+		uint32_t spTmp = sp;
+		uint32_t dlen = bam_cigar_oplen(cigar[i]);
+		for (std::size_t j = i + 1; j < rec->core.n_cigar; ++j) {
+		  if ((bam_cigar_op(cigar[j]) == BAM_CMATCH) || (bam_cigar_op(cigar[j]) == BAM_CEQUAL) || (bam_cigar_op(cigar[j]) == BAM_CDIFF)) {
+		    spTmp += bam_cigar_oplen(cigar[j]);
+		    rpTmp += bam_cigar_oplen(cigar[j]);
+		    if ((double) (spTmp - sp) / (double) (dlen + (rpTmp - rp)) > c.indelExtension) break;
+		  } else if (bam_cigar_op(cigar[j]) == BAM_CDEL) {
+		    rpTmp += bam_cigar_oplen(cigar[j]);
+		    if (bam_cigar_oplen(cigar[j]) > c.minRefSep) {
+		      // Extend deletion
+		      dlen += (rpTmp - rp);
+		      rp = rpTmp;
+		      sp = spTmp;
+		      i = j;
+		    }
+		  } else if (bam_cigar_op(cigar[j]) == BAM_CINS) {
+		    if (bam_cigar_oplen(cigar[j]) > c.minRefSep) break; // No extension
+		    spTmp += bam_cigar_oplen(cigar[j]);
+		  } else break; // No extension
 		}
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CINS) {
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
-		sp += bam_cigar_oplen(cigar[i]);
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) { // Try look-ahead
-		  uint32_t rpOrig = rp;
-		  uint32_t rpTmp = rp;
-		  uint32_t spTmp = sp;
-		  uint32_t ilen = bam_cigar_oplen(cigar[i]);
-		  for (std::size_t j = i + 1; j < rec->core.n_cigar; ++j) {
-		    if ((bam_cigar_op(cigar[j]) == BAM_CMATCH) || (bam_cigar_op(cigar[j]) == BAM_CEQUAL) || (bam_cigar_op(cigar[j]) == BAM_CDIFF)) {
-		      spTmp += bam_cigar_oplen(cigar[j]);
-		      rpTmp += bam_cigar_oplen(cigar[j]);
-		      if ((double) (rpTmp - rp) / (double) (ilen + (spTmp - sp)) > c.indelExtension) break;
-		    } else if (bam_cigar_op(cigar[j]) == BAM_CDEL) {
-		      if (bam_cigar_oplen(cigar[j]) > c.minRefSep) break; // No extension
-		      rpTmp += bam_cigar_oplen(cigar[j]);
-		    } else if (bam_cigar_op(cigar[j]) == BAM_CINS) {
-		      spTmp += bam_cigar_oplen(cigar[j]);
-		      if (bam_cigar_oplen(cigar[j]) > c.minRefSep) {
-			// Extend insertion
-			ilen += (spTmp - sp);
-			rp = rpTmp;
-			sp = spTmp;
-			i = j;
-		      }
-		    } else {
-		      break; // No extension
+		_insertJunction(readBp, seed, rec, rp, spOrig, true);
+	      }
+	    } else if (bam_cigar_op(cigar[i]) == BAM_CINS) {
+	      if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
+	      sp += bam_cigar_oplen(cigar[i]);
+	      if (bam_cigar_oplen(cigar[i]) > c.minRefSep) { // Try look-ahead
+		uint32_t rpOrig = rp;
+		uint32_t rpTmp = rp;
+		uint32_t spTmp = sp;
+		uint32_t ilen = bam_cigar_oplen(cigar[i]);
+		for (std::size_t j = i + 1; j < rec->core.n_cigar; ++j) {
+		  if ((bam_cigar_op(cigar[j]) == BAM_CMATCH) || (bam_cigar_op(cigar[j]) == BAM_CEQUAL) || (bam_cigar_op(cigar[j]) == BAM_CDIFF)) {
+		    spTmp += bam_cigar_oplen(cigar[j]);
+		    rpTmp += bam_cigar_oplen(cigar[j]);
+		    if ((double) (rpTmp - rp) / (double) (ilen + (spTmp - sp)) > c.indelExtension) break;
+		  } else if (bam_cigar_op(cigar[j]) == BAM_CDEL) {
+		    if (bam_cigar_oplen(cigar[j]) > c.minRefSep) break; // No extension
+		    rpTmp += bam_cigar_oplen(cigar[j]);
+		  } else if (bam_cigar_op(cigar[j]) == BAM_CINS) {
+		    spTmp += bam_cigar_oplen(cigar[j]);
+		    if (bam_cigar_oplen(cigar[j]) > c.minRefSep) {
+		      // Extend insertion
+		      ilen += (spTmp - sp);
+		      rp = rpTmp;
+		      sp = spTmp;
+		      i = j;
 		    }
+		  } else {
+		    break; // No extension
 		  }
-		  _insertJunction(readBp, seed, rec, rpOrig, sp, true);
-		}
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CREF_SKIP) {
-		rp += bam_cigar_oplen(cigar[i]);
-	      } else if ((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) {
-		int32_t finalsp = sp;
-		bool scleft = false;
-		if (sp == 0) {
-		  finalsp += bam_cigar_oplen(cigar[i]); // Leading soft-clip / hard-clip
-		  scleft = true;
 		}
-		sp += bam_cigar_oplen(cigar[i]);
-		//std::cerr << bam_get_qname(rec) << ',' << rp << ',' << finalsp << ',' << scleft << std::endl;
-		if (bam_cigar_oplen(cigar[i]) > c.minClip) _insertJunction(readBp, seed, rec, rp, finalsp, scleft);
-	      } else {
-		std::cerr << "Unknown Cigar options" << std::endl;
+		_insertJunction(readBp, seed, rec, rpOrig, sp, true);
+	      }
+	    } else if (bam_cigar_op(cigar[i]) == BAM_CREF_SKIP) {
+	      rp += bam_cigar_oplen(cigar[i]);
+	    } else if ((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) {
+	      int32_t finalsp = sp;
+	      bool scleft = false;
+	      if (sp == 0) {
+		finalsp += bam_cigar_oplen(cigar[i]); // Leading soft-clip / hard-clip
+		scleft = true;
 	      }
+	      sp += bam_cigar_oplen(cigar[i]);
+	      //std::cerr << bam_get_qname(rec) << ',' << rp << ',' << finalsp << ',' << scleft << std::endl;
+	      if (bam_cigar_oplen(cigar[i]) > c.minClip) _insertJunction(readBp, seed, rec, rp, finalsp, scleft);
+	    } else {
+	      std::cerr << "Unknown Cigar options" << std::endl;
 	    }
 	  }
-	  bam_destroy1(rec);
-	  hts_itr_destroy(iter);
 	}
+	bam_destroy1(rec);
+	hts_itr_destroy(iter);
       }
     }
 
@@ -414,11 +554,7 @@ namespace torali
     }
 
     // Clean-up
-    bam_hdr_destroy(hdr);
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
 
 
@@ -486,9 +622,7 @@ namespace torali
   template<typename TConfig>
   inline void
   outputSRBamRecords(TConfig const& c, std::vector<std::vector<SRBamRecord> > const& br) {
-    samFile* samfile = sam_open(c.files[0].string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
 
     // Header
     std::cerr << "chr1\tpos1\tchr2\tpos2\tsvtype\tct\tinslen" << std::endl;
@@ -499,9 +633,6 @@ namespace torali
 	std::cerr << hdr->target_name[br[svt][i].chr] << '\t' << br[svt][i].pos << '\t' << hdr->target_name[br[svt][i].chr2] << '\t' << br[svt][i].pos2 << '\t' << _addID(svt) << '\t' << _addOrientation(svt) << '\t' << br[svt][i].inslen << std::endl;
       }
     }
-    // Clean-up
-    bam_hdr_destroy(hdr);
-    sam_close(samfile);
   }
 
   template<typename TConfig, typename TSvtSRBamRecord>
@@ -518,16 +649,15 @@ namespace torali
     TSamFile samfile(c.files.size());
     TIndex idx(c.files.size());
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
     }
-    bam_hdr_t* hdr = sam_hdr_read(samfile[0]);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
     for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
       for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
 	hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, 0, hdr->target_len[refIndex]);
 	bam1_t* rec = bam_init1();
-	while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
+	while (_ioItrNext(samfile[file_c], iter, rec) >= 0) {
 	  if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
 	  std::size_t seed = hash_lr(rec);
 	  std::string qname = bam_get_qname(rec);
@@ -562,20 +692,14 @@ namespace torali
     }
 
     // Clean-up
-    bam_hdr_destroy(hdr);
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
 
 
   template<typename TConfig>
   inline void
   outputStructuralVariants(TConfig const& c, std::vector<StructuralVariantRecord> const& svs, int32_t const svt) {
-    samFile* samfile = sam_open(c.files[0].string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
 
     // Header
     std::cerr << "chr1\tpos1\tchr2\tpos2\tsvtype\tct\tpeSupport\tsrSupport" << std::endl;
@@ -585,10 +709,6 @@ namespace torali
       if (svs[i].svt != svt) continue;
       std::cerr << hdr->target_name[svs[i].chr] << '\t' << svs[i].svStart << '\t' << hdr->target_name[svs[i].chr2] << '\t' << svs[i].svEnd << '\t' << _addID(svs[i].svt) << '\t' << _addOrientation(svs[i].svt) << '\t' << svs[i].peSupport << '\t' << svs[i].srSupport << std::endl;
     }
-    
-    // Clean-up
-    bam_hdr_destroy(hdr);
-    sam_close(samfile);
   }
   
 
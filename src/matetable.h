@@ -0,0 +1,132 @@
+#ifndef MATETABLE_H
+#define MATETABLE_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+
+namespace torali
+{
+
+  // Flat open-addressing table of in-flight read pairs keyed by pair hash, mates are erased on pairing
+  template<typename TValue>
+  struct MateTable {
+    struct Slot {
+      std::size_t key;
+      TValue value;
+
+      Slot() : key(0), value() {}
+    };
+
+    typedef std::vector<Slot> TSlots;
+    TSlots slots;
+    std::size_t count;
+    uint32_t bits;
+
+    MateTable() : slots(16), count(0), bits(4) {}
+
+    inline std::size_t
+    size() const {
+      return count;
+    }
+
+    inline bool
+    empty() const {
+      return (count == 0);
+    }
+
+    inline void
+    clear() {
+      TSlots().swap(slots);
+      slots.resize(16);
+      count = 0;
+      bits = 4;
+    }
+
+    // Store the first mate, an existing entry is overwritten
+    inline void
+    insert(std::size_t key, TValue const& value) {
+      if (!key) key = 1;
+      if (2 * (count + 1) > slots.size()) _grow();
+      std::size_t mask = slots.size() - 1;
+      std::size_t i = _home(key);
+      while (slots[i].key) {
+	if (slots[i].key == key) {
+	  slots[i].value = value;
+	  return;
+	}
+	i = (i + 1) & mask;
+      }
+      slots[i].key = key;
+      slots[i].value = value;
+      ++count;
+    }
+
+    // Look-up the first mate without removing it
+    inline TValue const*
+    find(std::size_t key) const {
+      if (!key) key = 1;
+      std::size_t mask = slots.size() - 1;
+      for(std::size_t i = _home(key); slots[i].key; i = (i + 1) & mask) {
+	if (slots[i].key == key) return &slots[i].value;
+      }
+      return NULL;
+    }
+
+    // Fetch and erase the first mate, returns false if the mate is missing
+    inline bool
+    take(std::size_t key, TValue& value) {
+      if (!key) key = 1;
+      std::size_t mask = slots.size() - 1;
+      for(std::size_t i = _home(key); slots[i].key; i = (i + 1) & mask) {
+	if (slots[i].key == key) {
+	  value = slots[i].value;
+	  _erase(i);
+	  return true;
+	}
+      }
+      return false;
+    }
+
+    // Fibonacci hashing spreads the pair hash over the table
+    inline std::size_t
+    _home(std::size_t const key) const {
+      return (std::size_t) (((uint64_t) key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+    }
+
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    inline void
+    _erase(std::size_t i) {
+      std::size_t mask = slots.size() - 1;
+      std::size_t j = i;
+      while (true) {
+	j = (j + 1) & mask;
+	if (!slots[j].key) break;
+	std::size_t h = _home(slots[j].key);
+	if (((j - h) & mask) >= ((j - i) & mask)) {
+	  slots[i] = slots[j];
+	  i = j;
+	}
+      }
+      slots[i].key = 0;
+      slots[i].value = TValue();
+      --count;
+    }
+
+    inline void
+    _grow() {
+      TSlots old;
+      old.swap(slots);
+      slots.resize(2 * old.size());
+      ++bits;
+      count = 0;
+      for(typename TSlots::const_iterator it = old.begin(); it != old.end(); ++it) {
+	if (it->key) insert(it->key, it->value);
+      }
+    }
+  };
+
+}
+
+#endif
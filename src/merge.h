@@ -96,7 +96,7 @@ void _fillIntervalMap(MergeConfig const& c, TGenomeIntervals& iScore, TContigMap
   boost::unordered_map<int32_t, std::string> refmap;
   for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
     ++show_progress;
-    htsFile* ifile = bcf_open(c.files[file_c].string().c_str(), "r");
+    htsFile* ifile = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
     bcf_hdr_t* hdr = bcf_hdr_read(ifile);
     bcf1_t* rec = bcf_init();
 
@@ -108,7 +108,7 @@ void _fillIntervalMap(MergeConfig const& c, TGenomeIntervals& iScore, TContigMap
     char* ct = NULL;
     int32_t nsvt = 0;
     char* svt = NULL;
-    while (bcf_read(ifile, hdr, rec) == 0) {
+    while (_ioBcfRead(ifile, hdr, rec) == 0) {
       bcf_unpack(rec, BCF_UN_INFO);
       // Check PASS
       bool pass = true;
@@ -248,7 +248,7 @@ void _outputSelectedIntervals(MergeConfig& c, TGenomeIntervals const& iSelected,
   std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Filtering SVs" << std::endl;
 
   // Open output VCF file
-  htsFile *fp = hts_open(c.outfile.string().c_str(), "wb");
+  htsFile *fp = _ioAttach(hts_open(c.outfile.string().c_str(), "wb"));
   bcf_hdr_t *hdr_out = bcf_hdr_init("w");
 
   // Write VCF header
@@ -314,11 +314,11 @@ void _outputSelectedIntervals(MergeConfig& c, TGenomeIntervals const& iSelected,
   TEof eof(c.files.size());
   uint32_t allEOF = 0;
   for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-    ifile[file_c] = bcf_open(c.files[file_c].string().c_str(), "r");
+    ifile[file_c] = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
     hdr[file_c] = bcf_hdr_read(ifile[file_c]);
     if (bcf_hdr_set_samples(hdr[file_c], NULL, false) != 0) std::cerr << "Error: Failed to set sample information!" << std::endl;
     rec[file_c] = bcf_init();
-    if (bcf_read(ifile[file_c], hdr[file_c], rec[file_c]) == 0) {
+    if (_ioBcfRead(ifile[file_c], hdr[file_c], rec[file_c]) == 0) {
       bcf_unpack(rec[file_c], BCF_UN_INFO);
       eof[file_c] = false;
     } else {
@@ -509,7 +509,7 @@ void _outputSelectedIntervals(MergeConfig& c, TGenomeIntervals const& iSelected,
     }
 
     // Fetch next record
-    if (bcf_read(ifile[idx], hdr[idx], rec[idx]) == 0) bcf_unpack(rec[idx], BCF_UN_INFO);
+    if (_ioBcfRead(ifile[idx], hdr[idx], rec[idx]) == 0) bcf_unpack(rec[idx], BCF_UN_INFO);
     else {
       ++allEOF;
       eof[idx] = true;
@@ -565,10 +565,10 @@ mergeBCFs(MergeConfig& c, std::vector<boost::filesystem::path> const& cts) {
   TEof eof(cts.size());
   uint32_t allEOF = 0;
   for(unsigned int file_c = 0; file_c < cts.size(); ++file_c) {
-    ifile[file_c] = bcf_open(cts[file_c].string().c_str(), "r");
+    ifile[file_c] = _ioAttach(bcf_open(cts[file_c].string().c_str(), "r"));
     hdr[file_c] = bcf_hdr_read(ifile[file_c]);
     rec[file_c] = bcf_init();
-    if (bcf_read(ifile[file_c], hdr[file_c], rec[file_c]) == 0) {
+    if (_ioBcfRead(ifile[file_c], hdr[file_c], rec[file_c]) == 0) {
       bcf_unpack(rec[file_c], BCF_UN_INFO);
       eof[file_c] = false;
     } else {
@@ -578,7 +578,7 @@ mergeBCFs(MergeConfig& c, std::vector<boost::filesystem::path> const& cts) {
   }
 
   // Open output VCF file
-  htsFile *fp = hts_open(c.outfile.string().c_str(), "wb");
+  htsFile *fp = _ioAttach(hts_open(c.outfile.string().c_str(), "wb"));
   bcf_hdr_t *hdr_out = bcf_hdr_dup(hdr[0]);
   if (bcf_hdr_write(fp, hdr_out) != 0) std::cerr << "Error: Failed to write BCF header!" << std::endl;
 
@@ -596,7 +596,7 @@ mergeBCFs(MergeConfig& c, std::vector<boost::filesystem::path> const& cts) {
     bcf_write1(fp, hdr_out, rec[idx]);
 
     // Fetch next record
-    if (bcf_read(ifile[idx], hdr[idx], rec[idx]) == 0) bcf_unpack(rec[idx], BCF_UN_INFO);
+    if (_ioBcfRead(ifile[idx], hdr[idx], rec[idx]) == 0) bcf_unpack(rec[idx], BCF_UN_INFO);
     else {
       ++allEOF;
       eof[idx] = true;
@@ -631,7 +631,7 @@ mergeRun(MergeConfig& c, int32_t const svt) {
   TContigMap contigMap;
   uint32_t numseq = 0;
   for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-    htsFile* ifile = bcf_open(c.files[file_c].string().c_str(), "r");
+    htsFile* ifile = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
     bcf_hdr_t* hdr = bcf_hdr_read(ifile);
     int nseq=0;
     const char** seqnames = bcf_hdr_seqnames(hdr, &nseq);
@@ -674,9 +674,11 @@ int merge(int argc, char **argv) {
   c.svcounter = 1;
 
   // Define generic options
+  int32_t ioThreads = 0;
   boost::program_options::options_description generic("Generic options");
   generic.add_options()
     ("help,?", "show help message")
+    ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
     ("outfile,o", boost::program_options::value<boost::filesystem::path>(&c.outfile)->default_value("sv.bcf"), "Merged SV BCF output file")
     ("chunks,u", boost::program_options::value<uint32_t>(&c.chunksize)->default_value(500), "max. chunk size to merge groups of BCF files")
     ("vaf,a", boost::program_options::value<float>(&c.vaf)->default_value(0.15), "min. fractional ALT support")
@@ -728,6 +730,9 @@ int merge(int argc, char **argv) {
   if (vm.count("precise")) c.filterForPrecise = true;
   else c.filterForPrecise = false;
 
+  // Shared I/O thread pool
+  _ioPoolInit(ioThreads);
+
   // Show cmd
   boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
   std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
@@ -745,7 +750,7 @@ int merge(int argc, char **argv) {
       std::cerr << "Input file list " << c.files[0].string() << " is missing!" << std::endl;
       return 1;
     }
-    htsFile* inf = bcf_open(c.files[0].string().c_str(), "r");
+    htsFile* inf = _ioAttach(bcf_open(c.files[0].string().c_str(), "r"));
     if (inf != NULL) {
       bcf_hdr_t* header = NULL;
       header = bcf_hdr_read(inf);
@@ -773,7 +778,7 @@ int merge(int argc, char **argv) {
     bcf_close(inf);
   }
   for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-    htsFile* ifile = bcf_open(c.files[file_c].string().c_str(), "r");
+    htsFile* ifile = _ioAttach(bcf_open(c.files[file_c].string().c_str(), "r"));
     if (!ifile) {
       std::cerr << "Fail to load " << c.files[file_c].string() << "!" << std::endl;
       return 1;
@@ -153,13 +153,13 @@ template<typename TConfig, typename TStructuralVariantRecord>
 inline void
 vcfParse(TConfig const& c, bam_hdr_t* hd, std::vector<TStructuralVariantRecord>& svs) {
   // Load bcf file
-  htsFile* ifile = bcf_open(c.vcffile.string().c_str(), "r");
+  htsFile* ifile = _ioAttach(bcf_open(c.vcffile.string().c_str(), "r"));
   bcf_hdr_t* hdr = bcf_hdr_read(ifile);
   bcf1_t* rec = bcf_init();
 
   // Parse genome if necessary
-  faidx_t* fai = fai_load(c.genome.string().c_str());
-  char* seq = NULL;
+  faidx_t* fai = _hFaiOpen(c.genome.string());
+  RefView seq;
   int32_t lastRefIndex = -1;
   
   // Parse bcf
@@ -194,7 +194,7 @@ vcfParse(TConfig const& c, bam_hdr_t* hd, std::vector<TStructuralVariantRecord>&
   int32_t nchr2 = 0;
   char* chr2 = NULL;
   uint16_t wimethod = 0; 
-  while (bcf_read(ifile, hdr, rec) == 0) {
+  while (_ioBcfRead(ifile, hdr, rec) == 0) {
     bcf_unpack(rec, BCF_UN_INFO);
 
     // Delly BCF file?
@@ -340,29 +340,27 @@ vcfParse(TConfig const& c, bam_hdr_t* hd, std::vector<TStructuralVariantRecord>&
 	svRec.ciendhigh = 50;
 
 	// Lazy loading of reference sequence
-	if ((seq == NULL) || (tid != lastRefIndex)) {
-	  if (seq != NULL) free(seq);
-	  int32_t seqlen = -1;
-	  seq = faidx_fetch_seq(fai, chrName.c_str(), 0, faidx_seq_len(fai, chrName.c_str()), &seqlen);
+	if ((!seq.loaded()) || (tid != lastRefIndex)) {
+	  seq.load(c.genome.string(), fai, chrName.c_str());
 	  lastRefIndex = tid;
 	}
 
 	// Build consensus sequence
-	if ((seq != NULL) && ((svRec.svStart + 15 < svRec.svEnd) || (svRec.insLen >= 15))) {
+	if ((seq.loaded()) && ((svRec.svStart + 15 < svRec.svEnd) || (svRec.insLen >= 15))) {
 	  int32_t buffer = 75;
 	  if (tagUse) {
 	    int32_t prefix = 0;
 	    if (buffer < rec->pos) prefix = rec->pos - buffer;
-	    std::string pref = boost::to_upper_copy(std::string(seq + prefix, seq + rec->pos + 1));
+	    std::string pref = boost::to_upper_copy(seq.slice(prefix, rec->pos + 1));
 	    int32_t suffix = svRec.svEnd + buffer;
-	    std::string suf = boost::to_upper_copy(std::string(seq + svRec.svEnd, seq + suffix));
+	    std::string suf = boost::to_upper_copy(seq.slice(svRec.svEnd, suffix));
 	    svRec.consensus = pref + suf;
 	  } else {
 	    int32_t prefix = 0;
 	    if (buffer < rec->pos) prefix = rec->pos - buffer;
-	    std::string pref = boost::to_upper_copy(std::string(seq + prefix, seq + rec->pos));
+	    std::string pref = boost::to_upper_copy(seq.slice(prefix, rec->pos));
 	    int32_t suffix = svRec.svEnd + buffer;
-	    std::string suf = boost::to_upper_copy(std::string(seq + svRec.svEnd - 1, seq + suffix));
+	    std::string suf = boost::to_upper_copy(seq.slice(svRec.svEnd - 1, suffix));
 	    svRec.consensus = pref + altAllele + suf;
 	  }
 	  svs.push_back(svRec);
@@ -388,8 +386,7 @@ vcfParse(TConfig const& c, bam_hdr_t* hd, std::vector<TStructuralVariantRecord>&
   free(chr2);
 
   // Clean-up index
-  if (seq != NULL) free(seq);
-  fai_destroy(fai);
+  _hFaiClose(fai);
   
   // Close VCF
   bcf_hdr_destroy(hdr);
@@ -405,13 +402,11 @@ vcfOutput(TConfig const& c, std::vector<TStructuralVariantRecord> const& svs, TJ
   // BoLog class
   BoLog<double> bl;
 
-  // Open one bam file header
-  samFile* samfile = sam_open(c.files[0].string().c_str(), "r");
-  hts_set_fai_filename(samfile, c.genome.string().c_str());
-  bam_hdr_t* bamhd = sam_hdr_read(samfile);
+  // Header of the first alignment file
+  bam_hdr_t* bamhd = _hHeader(c.files[0].string());
 
   // Output all structural variants
-  htsFile *fp = hts_open(c.outfile.string().c_str(), "wb");
+  htsFile *fp = _ioAttach(hts_open(c.outfile.string().c_str(), "wb"));
   bcf_hdr_t *hdr = bcf_hdr_init("w");
 
   // Print vcf header
@@ -709,10 +704,6 @@ vcfOutput(TConfig const& c, std::vector<TStructuralVariantRecord> const& svs, TJ
     free(gqval);
   }
 
-  // Close BAM file
-  bam_hdr_destroy(bamhd);
-  sam_close(samfile);
-
   // Close VCF file
   bcf_hdr_destroy(hdr);
   hts_close(fp);
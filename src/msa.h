@@ -4,17 +4,20 @@
 #include <boost/multi_array.hpp>
 #include "needle.h"
 #include "gotoh.h"
+#include "seqstore.h"
 
 namespace torali {
 
+  template<typename TSeq>
   inline int32_t
-  lcs(std::string const& s1, std::string const& s2) {
+  lcs(TSeq const& s1, TSeq const& s2) {
     uint32_t m = s1.size();
     uint32_t n = s2.size();
     int32_t prevdiag = 0;
     int32_t prevprevdiag = 0;
     std::vector<int32_t> onecol(n+1, 0);
     for(uint32_t i = 0; i <= m; ++i) {
+      char c1 = (i) ? s1[i-1] : 0;
       for(uint32_t j = 0; j <= n; ++j) {
 	if ((i==0) || (j==0)) {
 	  onecol[j] = 0;
@@ -23,7 +26,7 @@ namespace torali {
 	} else {
 	  prevprevdiag = prevdiag;
 	  prevdiag = onecol[j];
-	  if (s1[i-1] == s2[j-1]) onecol[j] = prevprevdiag + 1;
+	  if (c1 == s2[j-1]) onecol[j] = prevprevdiag + 1;
 	  else onecol[j] = (onecol[j] > onecol[j-1]) ? onecol[j] : onecol[j-1];
 	}
       }
@@ -98,8 +101,7 @@ namespace torali {
       typename TSplitReadSet::const_iterator sIt = sps.begin();
       if (root) std::advance(sIt, root);
       align.resize(boost::extents[1][sIt->size()]);
-      TAIndex ind = 0;
-      for(typename std::string::const_iterator str = sIt->begin(); str != sIt->end(); ++str) align[0][ind++] = *str;
+      for(TAIndex ind = 0; ind < (TAIndex) sIt->size(); ++ind) align[0][ind] = (*sIt)[ind];
     } else {
       TAlign align1;
       palign(c, sps, p, p[root][1], align1);
@@ -288,6 +290,16 @@ namespace torali {
     return align.shape()[0];
   }
 
+  // Reads of one SV in the packed store, unpacked once into one scratch buffer in the order of a std::set<std::string>
+  template<typename TConfig>
+  inline int
+  msa(TConfig const& c, SequenceArena const& arena, uint32_t const svid, std::string& cs) {
+    std::string scratch;
+    std::vector<UnpackedRead> sps;
+    _unpackReads(arena, svid, scratch, sps);
+    return msa(c, sps, cs);
+  }
+
 }
 
 #endif
@@ -0,0 +1,150 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <vector>
+#include <pthread.h>
+
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+
+#include "iopool.h"
+
+
+namespace torali
+{
+
+  #ifndef DELLY_PREFETCH_BATCH
+  #define DELLY_PREFETCH_BATCH 256
+  #endif
+
+  // Decoded records of one batch, ret is the iterator status after the last record
+  struct RecordBatch {
+    std::vector<bam1_t*> rec;
+    uint32_t n;
+    int ret;
+
+    RecordBatch() : rec(DELLY_PREFETCH_BATCH, (bam1_t*) NULL), n(0), ret(0) {}
+  };
+
+  // Bounded ring of record batches, a producer thread decodes ahead while the caller processes records.
+  // The iterator must outlive the prefetcher, hence it is scoped to the loop: for(RecordPrefetch pf(fp, iter); pf.next(rec) >= 0;)
+  struct RecordPrefetch {
+    samFile* fp;
+    hts_itr_t* iter;
+    bool threaded;
+    bool stop;
+    uint32_t head;
+    uint32_t count;
+    uint32_t pos;
+    RecordBatch* cur;
+    std::vector<RecordBatch> ring;
+    pthread_t producer;
+    pthread_mutex_t mtx;
+    pthread_cond_t notFull;
+    pthread_cond_t notEmpty;
+
+    RecordPrefetch(samFile* f, hts_itr_t* it) : fp(f), iter(it), threaded(false), stop(false), head(0), count(0), pos(0), cur(NULL) {
+      int32_t depth = _ioPool().prefetch;
+      if ((depth <= 0) || (fp == NULL) || (iter == NULL)) return;
+      ring.resize(depth + 1);
+      for(uint32_t i = 0; i < ring.size(); ++i) {
+	for(uint32_t k = 0; k < ring[i].rec.size(); ++k) ring[i].rec[k] = bam_init1();
+      }
+      pthread_mutex_init(&mtx, NULL);
+      pthread_cond_init(&notFull, NULL);
+      pthread_cond_init(&notEmpty, NULL);
+      threaded = (pthread_create(&producer, NULL, _produce, this) == 0);
+      if (!threaded) _release();
+    }
+
+    ~RecordPrefetch() {
+      if (!threaded) return;
+      pthread_mutex_lock(&mtx);
+      stop = true;
+      pthread_cond_signal(&notFull);
+      pthread_mutex_unlock(&mtx);
+      pthread_join(producer, NULL);
+      _release();
+    }
+
+    // Next record, swapped into rec, same return convention as sam_itr_next
+    inline int
+    next(bam1_t* rec) {
+      if (!threaded) return _ioItrNext(fp, iter, rec);
+      while (true) {
+	if (cur != NULL) {
+	  if (pos < cur->n) {
+	    bam1_t tmp = *rec;
+	    *rec = *cur->rec[pos];
+	    *cur->rec[pos] = tmp;
+	    ++pos;
+	    return 0;
+	  }
+	  if (cur->ret < 0) return cur->ret;
+	}
+	pthread_mutex_lock(&mtx);
+	if (cur != NULL) {
+	  // Hand the consumed batch back to the producer
+	  head = (head + 1) % ring.size();
+	  --count;
+	  pthread_cond_signal(&notFull);
+	}
+	if (!count) {
+	  uint64_t t0 = _ioNowNs();
+	  while (!count) pthread_cond_wait(&notEmpty, &mtx);
+	  if (_ioPool().tp.pool != NULL) _ioAddWait(_ioNowNs() - t0);
+	}
+	cur = &ring[head];
+	pos = 0;
+	pthread_mutex_unlock(&mtx);
+      }
+    }
+
+    static void*
+    _produce(void* arg) {
+      RecordPrefetch* pf = (RecordPrefetch*) arg;
+      uint32_t tail = 0;
+      while (true) {
+	// One slot stays with the consumer while it processes the current batch
+	pthread_mutex_lock(&pf->mtx);
+	while ((!pf->stop) && (pf->count + 1 >= pf->ring.size())) pthread_cond_wait(&pf->notFull, &pf->mtx);
+	bool stopped = pf->stop;
+	pthread_mutex_unlock(&pf->mtx);
+	if (stopped) break;
+	RecordBatch& b = pf->ring[tail];
+	b.n = 0;
+	b.ret = 0;
+	while (b.n < b.rec.size()) {
+	  b.ret = sam_itr_next(pf->fp, pf->iter, b.rec[b.n]);
+	  if (b.ret < 0) break;
+	  ++b.n;
+	}
+	pthread_mutex_lock(&pf->mtx);
+	tail = (tail + 1) % pf->ring.size();
+	++pf->count;
+	pthread_cond_signal(&pf->notEmpty);
+	pthread_mutex_unlock(&pf->mtx);
+	if (b.ret < 0) break;
+      }
+      return NULL;
+    }
+
+    inline void
+    _release() {
+      for(uint32_t i = 0; i < ring.size(); ++i) {
+	for(uint32_t k = 0; k < ring[i].rec.size(); ++k) bam_destroy1(ring[i].rec[k]);
+      }
+      ring.clear();
+      pthread_cond_destroy(&notEmpty);
+      pthread_cond_destroy(&notFull);
+      pthread_mutex_destroy(&mtx);
+    }
+
+  private:
+    RecordPrefetch(RecordPrefetch const&);
+    RecordPrefetch& operator=(RecordPrefetch const&);
+  };
+
+}
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef REFCACHE_H
+#define REFCACHE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <htslib/faidx.h>
+
+
+namespace torali
+{
+
+  // Packed reference image <genome>.d2b: 2-bit bases, runs of other characters and soft-masked runs
+  #ifndef DELLY_REF_SUFFIX
+  #define DELLY_REF_SUFFIX ".d2b"
+  #endif
+
+  #define DELLY_REF_MAGIC "DLY2BIT1"
+
+  struct RefImageHeader {
+    char magic[8];
+    uint64_t fastaSize;
+    uint64_t fastaMtime;
+    uint64_t nseq;
+  };
+
+  struct RefImageSeq {
+    uint64_t nameOff;
+    uint64_t len;
+    uint64_t seqOff;
+    uint64_t excOff;
+    uint64_t nexc;
+    uint64_t maskOff;
+    uint64_t nmask;
+  };
+
+  // Run of a character other than A, C, G, T (any case)
+  struct RefExcRun {
+    uint32_t start;
+    uint32_t len;
+    uint32_t c;
+  };
+
+  // Run of lower-case bases
+  struct RefMaskRun {
+    uint32_t start;
+    uint32_t len;
+  };
+
+  // Read-only mapping of an image, shared by all threads and by processes through the page cache
+  struct RefImage {
+    uint8_t const* base;
+    std::size_t size;
+    RefImageSeq const* seqs;
+    std::map<std::string, uint32_t> names;
+    char lut[256][4];
+
+    RefImage() : base(NULL), size(0), seqs(NULL) {}
+  };
+
+  inline std::string
+  _refImageFile(std::string const& genome) {
+    return genome + DELLY_REF_SUFFIX;
+  }
+
+  inline uint8_t
+  _refCode(char const c) {
+    switch(c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return 4;
+    }
+  }
+
+  inline uint64_t
+  _refAlign(std::ofstream& out) {
+    uint64_t off = out.tellp();
+    while (off % 8) {
+      out.put(0);
+      ++off;
+    }
+    return off;
+  }
+
+  // Build the packed image of an indexed FASTA file
+  inline bool
+  _refImageBuild(std::string const& genome, std::string const& outfile) {
+    struct stat st;
+    if (stat(genome.c_str(), &st) != 0) {
+      std::cerr << "Reference file is missing: " << genome << std::endl;
+      return false;
+    }
+    faidx_t* fai = fai_load(genome.c_str());
+    if (fai == NULL) {
+      std::cerr << "Fail to open genome fai index for " << genome << std::endl;
+      return false;
+    }
+    std::ofstream out(outfile.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+      std::cerr << "Fail to write " << outfile << std::endl;
+      fai_destroy(fai);
+      return false;
+    }
+    RefImageHeader h;
+    std::memcpy(h.magic, DELLY_REF_MAGIC, 8);
+    h.fastaSize = st.st_size;
+    h.fastaMtime = st.st_mtime;
+    h.nseq = faidx_nseq(fai);
+    out.write((char const*) &h, sizeof(RefImageHeader));
+    std::vector<RefImageSeq> seqs(h.nseq);
+    if (h.nseq) out.write((char const*) &seqs[0], h.nseq * sizeof(RefImageSeq));
+    bool ok = true;
+    for(uint32_t i = 0; ((ok) && (i < h.nseq)); ++i) {
+      char const* name = faidx_iseq(fai, i);
+      seqs[i].nameOff = out.tellp();
+      out.write(name, std::strlen(name) + 1);
+      int32_t seqlen = -1;
+      char* seq = faidx_fetch_seq(fai, name, 0, faidx_seq_len(fai, name), &seqlen);
+      if ((seq == NULL) || (seqlen < 0)) {
+	std::cerr << "Fail to fetch " << name << " from " << genome << std::endl;
+	ok = false;
+	break;
+      }
+      seqs[i].len = seqlen;
+
+      // Bases, 4 per byte
+      std::vector<RefExcRun> exc;
+      std::vector<RefMaskRun> mask;
+      std::vector<uint8_t> packed((seqlen + 3) / 4, 0);
+      for(int32_t k = 0; k < seqlen; ++k) {
+	uint8_t code = _refCode(seq[k]);
+	if (code == 4) {
+	  if ((!exc.empty()) && (exc.back().start + exc.back().len == (uint32_t) k) && (exc.back().c == (uint32_t) (uint8_t) seq[k])) ++exc.back().len;
+	  else {
+	    RefExcRun r;
+	    r.start = k;
+	    r.len = 1;
+	    r.c = (uint8_t) seq[k];
+	    exc.push_back(r);
+	  }
+	  code = 0;
+	} else if ((seq[k] >= 'a') && (seq[k] <= 'z')) {
+	  if ((!mask.empty()) && (mask.back().start + mask.back().len == (uint32_t) k)) ++mask.back().len;
+	  else {
+	    RefMaskRun r;
+	    r.start = k;
+	    r.len = 1;
+	    mask.push_back(r);
+	  }
+	}
+	packed[k / 4] |= (code << (2 * (k % 4)));
+      }
+      free(seq);
+      seqs[i].seqOff = _refAlign(out);
+      if (!packed.empty()) out.write((char const*) &packed[0], packed.size());
+      seqs[i].excOff = _refAlign(out);
+      seqs[i].nexc = exc.size();
+      if (!exc.empty()) out.write((char const*) &exc[0], exc.size() * sizeof(RefExcRun));
+      seqs[i].maskOff = _refAlign(out);
+      seqs[i].nmask = mask.size();
+      if (!mask.empty()) out.write((char const*) &mask[0], mask.size() * sizeof(RefMaskRun));
+    }
+    if ((ok) && (h.nseq)) {
+      out.seekp(sizeof(RefImageHeader));
+      out.write((char const*) &seqs[0], h.nseq * sizeof(RefImageSeq));
+    }
+    out.close();
+    fai_destroy(fai);
+    if ((!ok) || (out.fail())) {
+      std::remove(outfile.c_str());
+      if (ok) std::cerr << "Fail to write " << outfile << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Map an image, NULL if there is none or it is older than the FASTA file
+  inline RefImage*
+  _refImageMap(std::string const& genome) {
+    std::string file = _refImageFile(genome);
+    struct stat fst;
+    struct stat ist;
+    if ((stat(genome.c_str(), &fst) != 0) || (stat(file.c_str(), &ist) != 0)) return NULL;
+    if ((std::size_t) ist.st_size < sizeof(RefImageHeader)) return NULL;
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return NULL;
+    void* base = mmap(NULL, ist.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+    RefImageHeader const* h = (RefImageHeader const*) base;
+    if ((std::memcmp(h->magic, DELLY_REF_MAGIC, 8) != 0) || (h->fastaSize != (uint64_t) fst.st_size) || (h->fastaMtime != (uint64_t) fst.st_mtime) || (sizeof(RefImageHeader) + h->nseq * sizeof(RefImageSeq) > (uint64_t) ist.st_size)) {
+      std::cerr << "Warning: Reference image " << file << " does not match " << genome << ", using the FASTA file!" << std::endl;
+      munmap(base, ist.st_size);
+      return NULL;
+    }
+    RefImage* img = new RefImage();
+    img->base = (uint8_t const*) base;
+    img->size = ist.st_size;
+    img->seqs = (RefImageSeq const*) (img->base + sizeof(RefImageHeader));
+    for(uint32_t i = 0; i < h->nseq; ++i) img->names[std::string((char const*) img->base + img->seqs[i].nameOff)] = i;
+    for(uint32_t b = 0; b < 256; ++b) {
+      for(uint32_t k = 0; k < 4; ++k) img->lut[b][k] = "ACGT"[(b >> (2 * k)) & 3];
+    }
+    return img;
+  }
+
+  // Process-wide images by genome file, mapped on first use
+  inline std::map<std::string, RefImage*>&
+  _refImages() {
+    static std::map<std::string, RefImage*> images;
+    return images;
+  }
+
+  inline void
+  _refImagesFinish() {
+    std::map<std::string, RefImage*>& images = _refImages();
+    for(std::map<std::string, RefImage*>::iterator it = images.begin(); it != images.end(); ++it) {
+      if (it->second != NULL) {
+	munmap((void*) it->second->base, it->second->size);
+	delete it->second;
+      }
+    }
+    images.clear();
+  }
+
+  inline RefImage const*
+  _refImage(std::string const& genome) {
+    RefImage* img = NULL;
+#pragma omp critical (refimage)
+    {
+      std::map<std::string, RefImage*>& images = _refImages();
+      std::map<std::string, RefImage*>::iterator it = images.find(genome);
+      if (it != images.end()) img = it->second;
+      else {
+	if (images.empty()) std::atexit(_refImagesFinish);
+	img = _refImageMap(genome);
+	images[genome] = img;
+      }
+    }
+    return img;
+  }
+
+  // First run ending after pos, runs are sorted and disjoint
+  template<typename TRun>
+  inline uint64_t
+  _refFirstRun(TRun const* runs, uint64_t const n, uint32_t const pos) {
+    uint64_t lo = 0;
+    uint64_t hi = n;
+    while (lo < hi) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (runs[mid].start + runs[mid].len <= pos) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  // Decode [beg, end) of a sequence into buf
+  inline void
+  _refDecode(RefImage const& img, RefImageSeq const& s, uint32_t const beg, uint32_t const end, char* buf) {
+    uint8_t const* packed = img.base + s.seqOff;
+    uint32_t k = beg;
+    for(; (k < end) && (k % 4); ++k) buf[k - beg] = img.lut[packed[k / 4]][k % 4];
+    for(; k + 4 <= end; k += 4) std::memcpy(buf + (k - beg), img.lut[packed[k / 4]], 4);
+    for(; k < end; ++k) buf[k - beg] = img.lut[packed[k / 4]][k % 4];
+
+    // Other characters and soft-masking
+    RefExcRun const* exc = (RefExcRun const*) (img.base + s.excOff);
+    for(uint64_t i = _refFirstRun(exc, s.nexc, beg); i < s.nexc; ++i) {
+      if (exc[i].start >= end) break;
+      uint32_t rb = std::max(exc[i].start, beg);
+      uint32_t re = std::min(exc[i].start + exc[i].len, end);
+      for(uint32_t p = rb; p < re; ++p) buf[p - beg] = (char) exc[i].c;
+    }
+    RefMaskRun const* mask = (RefMaskRun const*) (img.base + s.maskOff);
+    for(uint64_t i = _refFirstRun(mask, s.nmask, beg); i < s.nmask; ++i) {
+      if (mask[i].start >= end) break;
+      uint32_t rb = std::max(mask[i].start, beg);
+      uint32_t re = std::min(mask[i].start + mask[i].len, end);
+      for(uint32_t p = rb; p < re; ++p) buf[p - beg] += ('a' - 'A');
+    }
+  }
+
+  // Same contract as faidx_fetch_seq (inclusive end, caller frees), served from the packed image if one was built for the genome
+  inline char*
+  _refFetch(std::string const& genome, faidx_t const* fai, char const* name, int32_t const beg, int32_t const endIncl, int32_t* len) {
+    RefImage const* img = _refImage(genome);
+    if (img == NULL) return faidx_fetch_seq(fai, name, beg, endIncl, len);
+    std::map<std::string, uint32_t>::const_iterator it = img->names.find(std::string(name));
+    if (it == img->names.end()) {
+      *len = -2;
+      return NULL;
+    }
+    RefImageSeq const& s = img->seqs[it->second];
+    uint32_t b = std::max(0, beg);
+    uint32_t e = std::min((uint64_t) std::max(0, endIncl) + 1, s.len);
+    if (b > e) b = e;
+    char* buf = (char*) malloc(e - b + 1);
+    if (buf == NULL) {
+      *len = -1;
+      return NULL;
+    }
+    _refDecode(*img, s, b, e, buf);
+    buf[e - b] = '\0';
+    *len = e - b;
+    return buf;
+  }
+
+  // One chromosome for callers that only need windows, slices are decoded from the packed image on demand.
+  // Without an image the chromosome is fetched once with faidx and slices are cut from it.
+  struct RefView {
+    RefImage const* img;
+    RefImageSeq const* s;
+    char* seq;
+    int32_t len;
+
+    RefView() : img(NULL), s(NULL), seq(NULL), len(-1) {}
+
+    ~RefView() {
+      release();
+    }
+
+    inline bool
+    loaded() const {
+      return (len >= 0);
+    }
+
+    inline bool
+    load(std::string const& genome, faidx_t const* fai, char const* name) {
+      release();
+      img = _refImage(genome);
+      if (img != NULL) {
+	std::map<std::string, uint32_t>::const_iterator it = img->names.find(std::string(name));
+	if (it != img->names.end()) {
+	  s = &img->seqs[it->second];
+	  len = s->len;
+	}
+      } else {
+	int32_t seqlen = -1;
+	seq = faidx_fetch_seq(fai, name, 0, faidx_seq_len(fai, name), &seqlen);
+	if (seq != NULL) len = seqlen;
+      }
+      return loaded();
+    }
+
+    inline void
+    release() {
+      if (seq != NULL) free(seq);
+      img = NULL;
+      s = NULL;
+      seq = NULL;
+      len = -1;
+    }
+
+    // Bases [beg, end), clipped to the chromosome
+    inline std::string
+    slice(int32_t beg, int32_t end) const {
+      beg = std::max(beg, 0);
+      end = std::min(end, len);
+      if (beg >= end) return std::string();
+      if (seq != NULL) return std::string(seq + beg, seq + end);
+      std::string out(end - beg, 'N');
+      _refDecode(*img, *s, beg, end, &out[0]);
+      return out;
+    }
+
+  private:
+    RefView(RefView const&);
+    RefView& operator=(RefView const&);
+  };
+
+  inline std::string
+  _refString(char const* ref, int32_t const beg, int32_t const end) {
+    return std::string(ref + beg, ref + end);
+  }
+
+  inline std::string
+  _refString(RefView const* ref, int32_t const beg, int32_t const end) {
+    return ref->slice(beg, end);
+  }
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef REFIMAGE_H
+#define REFIMAGE_H
+
+#include <iostream>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include <htslib/faidx.h>
+
+#include "version.h"
+#include "util.h"
+
+namespace torali
+{
+
+struct RefImageConfig {
+  boost::filesystem::path genome;
+};
+
+
+int refimage(int argc, char **argv) {
+  RefImageConfig c;
+
+  // Define generic options
+  boost::program_options::options_description generic("Generic options");
+  generic.add_options()
+    ("help,?", "show help message")
+    ;
+
+  // Define hidden options
+  boost::program_options::options_description hidden("Hidden options");
+  hidden.add_options()
+    ("input-file", boost::program_options::value<boost::filesystem::path>(&c.genome), "input file")
+    ;
+  boost::program_options::positional_options_description pos_args;
+  pos_args.add("input-file", -1);
+
+  // Set the visibility
+  boost::program_options::options_description cmdline_options;
+  cmdline_options.add(generic).add(hidden);
+  boost::program_options::options_description visible_options;
+  visible_options.add(generic);
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(cmdline_options).positional(pos_args).run(), vm);
+  boost::program_options::notify(vm);
+
+  // Check command line arguments
+  if ((vm.count("help")) || (!vm.count("input-file"))) {
+    std::cout << std::endl;
+    std::cout << "Usage: delly " << argv[0] << " [OPTIONS] <genome.fa>" << std::endl;
+    std::cout << visible_options << "\n";
+    std::cout << "Writes <genome.fa>" << DELLY_REF_SUFFIX << ", used by all commands that are run with -g <genome.fa>" << std::endl;
+    return 0;
+  }
+
+  // Check reference
+  if (!(boost::filesystem::exists(c.genome) && boost::filesystem::is_regular_file(c.genome) && boost::filesystem::file_size(c.genome))) {
+    std::cerr << "Reference file is missing: " << c.genome.string() << std::endl;
+    return 1;
+  } else {
+    faidx_t* fai = fai_load(c.genome.string().c_str());
+    if (fai == NULL) {
+      if (fai_build(c.genome.string().c_str()) == -1) {
+	std::cerr << "Fail to open genome fai index for " << c.genome.string() << std::endl;
+	return 1;
+      }
+    } else fai_destroy(fai);
+  }
+
+  // Show cmd
+  boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] ";
+  std::cout << "delly ";
+  for(int i=0; i<argc; ++i) { std::cout << argv[i] << ' '; }
+  std::cout << std::endl;
+
+  // Pack reference
+  now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Pack reference" << std::endl;
+  if (!_refImageBuild(c.genome.string(), _refImageFile(c.genome.string()))) return 1;
+
+  // End
+  now = boost::posix_time::second_clock::local_time();
+  std::cout << '[' << boost::posix_time::to_simple_string(now) << "] Done." << std::endl;
+  return 0;
+}
+
+}
+
+#endif
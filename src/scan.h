@@ -80,10 +80,9 @@ namespace torali
   scan(TConfig const& c, LibraryInfo const& li, std::vector< std::vector<ScanWindow> >& scanCounts) {
 
     // Load bam file
-    samFile* samfile = sam_open(c.bamFile.string().c_str(), "r");
-    hts_set_fai_filename(samfile, c.genome.string().c_str());
-    hts_idx_t* idx = sam_index_load(samfile, c.bamFile.string().c_str());
-    bam_hdr_t* hdr = sam_hdr_read(samfile);
+    samFile* samfile = _hOpen(c.bamFile.string(), c.genome.string(), DELLY_CRAM_COVERAGE);
+    hts_idx_t* idx = _hIndex(samfile);
+    bam_hdr_t* hdr = _hHeader(c.bamFile.string());
 
     // Pre-defined scanning windows
     if (c.hasScanFile) {
@@ -117,7 +116,7 @@ namespace torali
 
     // Iterate chromosomes
     uint64_t totalCov = 0;
-    faidx_t* faiMap = fai_load(c.mapFile.string().c_str());
+    faidx_t* faiMap = _hFaiOpen(c.mapFile.string());
     for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
       ++show_progress;
       if (chrNoData(c, refIndex, idx)) continue;
@@ -178,7 +177,7 @@ namespace torali
       }
 	
       // Mate map
-      typedef boost::unordered_map<std::size_t, bool> TMateMap;
+      typedef MateTable<bool> TMateMap;
       TMateMap mateMap;
 
       // Count reads
@@ -186,7 +185,7 @@ namespace torali
       bam1_t* rec = bam_init1();
       int32_t lastAlignedPos = 0;
       std::set<std::size_t> lastAlignedPosReads;
-      while (sam_itr_next(samfile, iter, rec) >= 0) {
+      while (_ioItrNext(samfile, iter, rec) >= 0) {
 	if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP)) continue;
 	if ((rec->core.flag & BAM_FPAIRED) && ((rec->core.flag & BAM_FMUNMAP) || (rec->core.tid != rec->core.mtid))) continue;
 	if (rec->core.qual < c.minQual) continue;
@@ -204,13 +203,13 @@ namespace torali
 	    // First read
 	    lastAlignedPosReads.insert(hash_string(bam_get_qname(rec)));
 	    std::size_t hv = hash_pair(rec);
-	    mateMap[hv] = true;
+	    mateMap.insert(hv, true);
 	    continue;
 	  } else {
 	    // Second read
 	    std::size_t hv = hash_pair_mate(rec);
-	    if ((mateMap.find(hv) == mateMap.end()) || (!mateMap[hv])) continue; // Mate discarded
-	    mateMap[hv] = false;
+	    bool mate = false;
+	    if (!mateMap.take(hv, mate)) continue; // Mate discarded
 	  }
 
 	  // Insert size filter
@@ -237,10 +236,8 @@ namespace torali
     }
     
     // clean-up
-    fai_destroy(faiMap);
-    bam_hdr_destroy(hdr);
-    hts_idx_destroy(idx);
-    sam_close(samfile);
+    _hFaiClose(faiMap);
+    _hClose(samfile);
   }
 
 
@@ -0,0 +1,224 @@
+#ifndef SEQSTORE_H
+#define SEQSTORE_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdint.h>
+
+#include "hash.h"
+
+
+namespace torali
+{
+
+  #define DELLY_SEQ_NONE 0xffffffffu
+
+  // One stored read, bases start byte-aligned in the arena
+  struct PackedSeq {
+    uint64_t hash;
+    uint32_t off;
+    uint32_t len;
+    uint32_t excOff;
+    uint32_t nexc;
+    uint32_t svid;
+    uint32_t next;
+  };
+
+  // Base other than A, C, G, T (N and IUPAC codes), stored as 0 in the 2-bit arena
+  struct PackedSeqExc {
+    uint32_t pos;
+    char c;
+  };
+
+  // Distinct read sequences per SV, 2-bit packed into one arena and de-duplicated through an open-addressing hash table.
+  // Reads of an SV are chained through PackedSeq::next, clear() unlinks them and compacts the arena once half of it is unused.
+  struct SequenceArena {
+    uint32_t dead;
+    std::vector<uint8_t> bases;
+    std::vector<PackedSeqExc> exc;
+    std::vector<PackedSeq> seqs;
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> count;
+
+    explicit SequenceArena(uint32_t const nsv) : dead(0), slots(1024, DELLY_SEQ_NONE), head(nsv, DELLY_SEQ_NONE), count(nsv, 0) {}
+
+    inline uint32_t
+    size(uint32_t const svid) const {
+      return count[svid];
+    }
+
+    // Insert a read for an SV, false if the SV already holds the same sequence
+    inline bool
+    insert(uint32_t const svid, std::string const& sequence) {
+      uint64_t h = hash_mix(hash_bytes(sequence.data(), sequence.size(), DELLY_HASH_SEED), svid);
+      uint32_t mask = slots.size() - 1;
+      uint32_t k = h & mask;
+      for(; slots[k] != DELLY_SEQ_NONE; k = (k + 1) & mask) {
+	PackedSeq const& s = seqs[slots[k]];
+	if ((s.hash == h) && (s.svid == svid) && (_equal(s, sequence))) return false;
+      }
+
+      // Pack bases
+      PackedSeq s;
+      s.hash = h;
+      s.off = bases.size();
+      s.len = sequence.size();
+      s.excOff = exc.size();
+      s.svid = svid;
+      s.next = head[svid];
+      bases.resize(bases.size() + (s.len + 3) / 4, 0);
+      for(uint32_t i = 0; i < s.len; ++i) {
+	uint8_t code = 0;
+	switch(sequence[i]) {
+	case 'A': code = 0; break;
+	case 'C': code = 1; break;
+	case 'G': code = 2; break;
+	case 'T': code = 3; break;
+	default: {
+	  PackedSeqExc e;
+	  e.pos = i;
+	  e.c = sequence[i];
+	  exc.push_back(e);
+	}
+	}
+	bases[s.off + i / 4] |= (code << (2 * (i % 4)));
+      }
+      s.nexc = exc.size() - s.excOff;
+      slots[k] = seqs.size();
+      head[svid] = seqs.size();
+      ++count[svid];
+      seqs.push_back(s);
+      if (2 * seqs.size() > slots.size()) _rehash(2 * slots.size());
+      return true;
+    }
+
+    // Drop the reads of an SV, they no longer match in insert()
+    inline void
+    clear(uint32_t const svid) {
+      for(uint32_t i = head[svid]; i != DELLY_SEQ_NONE; i = seqs[i].next) seqs[i].svid = DELLY_SEQ_NONE;
+      dead += count[svid];
+      head[svid] = DELLY_SEQ_NONE;
+      count[svid] = 0;
+      if (2 * dead > seqs.size()) _compact();
+    }
+
+    inline char
+    _base(PackedSeq const& s, uint32_t const i) const {
+      return "ACGT"[(bases[s.off + i / 4] >> (2 * (i % 4))) & 3];
+    }
+
+    inline bool
+    _equal(PackedSeq const& s, std::string const& sequence) const {
+      if (s.len != sequence.size()) return false;
+      uint32_t e = s.excOff;
+      for(uint32_t i = 0; i < s.len; ++i) {
+	if ((e < s.excOff + s.nexc) && (exc[e].pos == i)) {
+	  if (exc[e].c != sequence[i]) return false;
+	  ++e;
+	} else if (_base(s, i) != sequence[i]) return false;
+      }
+      return true;
+    }
+
+    // Move the reads still linked to an SV into fresh buffers
+    inline void
+    _compact() {
+      std::vector<uint32_t> pos(seqs.size(), DELLY_SEQ_NONE);
+      std::vector<uint8_t> cbases;
+      std::vector<PackedSeqExc> cexc;
+      std::vector<PackedSeq> cseqs;
+      cseqs.reserve(seqs.size() - dead);
+      for(uint32_t i = 0; i < seqs.size(); ++i) {
+	if (seqs[i].svid == DELLY_SEQ_NONE) continue;
+	PackedSeq s = seqs[i];
+	s.off = cbases.size();
+	s.excOff = cexc.size();
+	cbases.insert(cbases.end(), bases.begin() + seqs[i].off, bases.begin() + seqs[i].off + (s.len + 3) / 4);
+	cexc.insert(cexc.end(), exc.begin() + seqs[i].excOff, exc.begin() + seqs[i].excOff + s.nexc);
+	pos[i] = cseqs.size();
+	cseqs.push_back(s);
+      }
+      for(uint32_t i = 0; i < cseqs.size(); ++i) {
+	if (cseqs[i].next != DELLY_SEQ_NONE) cseqs[i].next = pos[cseqs[i].next];
+      }
+      for(uint32_t svid = 0; svid < head.size(); ++svid) {
+	if (head[svid] != DELLY_SEQ_NONE) head[svid] = pos[head[svid]];
+      }
+      bases.swap(cbases);
+      exc.swap(cexc);
+      seqs.swap(cseqs);
+      dead = 0;
+      uint32_t nslots = 1024;
+      while (nslots < 2 * seqs.size()) nslots *= 2;
+      _rehash(nslots);
+    }
+
+    inline void
+    _rehash(uint32_t const nslots) {
+      std::vector<uint32_t>(nslots, DELLY_SEQ_NONE).swap(slots);
+      uint32_t mask = slots.size() - 1;
+      for(uint32_t i = 0; i < seqs.size(); ++i) {
+	if (seqs[i].svid == DELLY_SEQ_NONE) continue;
+	uint32_t k = seqs[i].hash & mask;
+	while (slots[k] != DELLY_SEQ_NONE) k = (k + 1) & mask;
+	slots[k] = i;
+      }
+    }
+  };
+
+  // Read of an SV as consumed by msa(), a slice of the unpacked scratch buffer of the SV
+  struct UnpackedRead {
+    char const* seq;
+    uint32_t len;
+
+    UnpackedRead(char const* s, uint32_t const l) : seq(s), len(l) {}
+
+    inline std::size_t
+    size() const {
+      return len;
+    }
+
+    inline char
+    operator[](uint32_t const i) const {
+      return seq[i];
+    }
+  };
+
+  // Same order as std::set<std::string>
+  template<typename TRead>
+  struct SortUnpackedReads : public std::binary_function<TRead, TRead, bool>
+  {
+    inline bool operator()(TRead const& r1, TRead const& r2) const {
+      int cmp = std::memcmp(r1.seq, r2.seq, std::min(r1.len, r2.len));
+      if (cmp) return (cmp < 0);
+      return (r1.len < r2.len);
+    }
+  };
+
+  // Unpack the reads of an SV once into scratch, reads are returned in lexicographic order
+  inline void
+  _unpackReads(SequenceArena const& arena, uint32_t const svid, std::string& scratch, std::vector<UnpackedRead>& reads) {
+    uint32_t total = 0;
+    for(uint32_t i = arena.head[svid]; i != DELLY_SEQ_NONE; i = arena.seqs[i].next) total += arena.seqs[i].len;
+    scratch.resize(total);
+    reads.clear();
+    reads.reserve(arena.size(svid));
+    uint32_t off = 0;
+    for(uint32_t i = arena.head[svid]; i != DELLY_SEQ_NONE; i = arena.seqs[i].next) {
+      PackedSeq const& s = arena.seqs[i];
+      char* out = &scratch[off];
+      for(uint32_t k = 0; k < s.len; ++k) out[k] = arena._base(s, k);
+      for(uint32_t k = s.excOff; k < s.excOff + s.nexc; ++k) out[arena.exc[k].pos] = arena.exc[k].c;
+      reads.push_back(UnpackedRead(out, s.len));
+      off += s.len;
+    }
+    std::sort(reads.begin(), reads.end(), SortUnpackedReads<UnpackedRead>());
+  }
+
+}
+
+#endif
@@ -36,6 +36,7 @@
 #include "split.h"
 #include "junction.h"
 #include "cluster.h"
+#include "evidence.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -43,14 +44,95 @@
 #include <zlib.h>
 #include <stdio.h>
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 namespace torali
 {
+
+  // Split-read sequence captured during the scan
+  struct SplitReadSeq {
+    int32_t pos;
+    uint8_t qual;
+    std::size_t seed;
+    std::string sequence;
+
+    SplitReadSeq(int32_t const p, uint8_t const q, std::size_t const s) : pos(p), qual(q), seed(s) {}
+  };
+
+  // Split-read sequences of one sample, complete chromosomes need no second BAM pass
+  struct SplitReadCache {
+    typedef std::vector<SplitReadSeq> TSplitReadSeqs;
+    std::vector<uint8_t> complete;
+    std::vector<TSplitReadSeqs> reads;
+
+    SplitReadCache() {}
+    explicit SplitReadCache(int32_t const nchr) : complete(nchr, 1), reads(nchr, TSplitReadSeqs()) {}
+  };
+
+
+  template<typename TQualities, typename TStructuralVariantRecord>
+  inline void
+  _collectSplitRead(std::string& sequence, int32_t const tid, int32_t const pos, uint8_t const qual, uint32_t const svid, std::vector<TStructuralVariantRecord> const& svs, uint32_t const maxReadPerSV, SequenceArena& seqStore, std::vector<TQualities>& qualStore, SequenceArena& traStore, std::vector<TQualities>& traQualStore) {
+    // Adjust orientation
+    bool bpPoint = false;
+    if (_translocation(svs[svid].svt)) {
+      if (tid == svs[svid].chr2) bpPoint = true;
+    } else {
+      // Only relevant for inversions
+      if (svs[svid].svt == 0) {
+	if (pos + 25 > svs[svid].svStart) bpPoint = true;
+	else bpPoint = false;
+      } else if (svs[svid].svt == 1) {
+	if (pos + 25 > svs[svid].svEnd) bpPoint = true;
+	else bpPoint = false;
+      }
+    }
+    _adjustOrientation(sequence, bpPoint, svs[svid].svt);
+		
+    // At most n split-reads
+    if (seqStore.size(svid) < maxReadPerSV) {
+      bool insertSuccess = false;
+      if (_translocation(svs[svid].svt)) insertSuccess = traStore.insert(svid, sequence);
+      else insertSuccess = seqStore.insert(svid, sequence);
+      // Store qualities
+      if (insertSuccess) {
+	if (_translocation(svs[svid].svt)) traQualStore[svid].push_back(qual);
+	else qualStore[svid].push_back(qual);
+      }
+    }
+  }
   
-  template<typename TConfig, typename TValidRegion, typename TSRStore, typename TStructuralVariantRecord>
+  // Consensus of one SV, only the SV itself is written so that SVs can be assembled concurrently
+  template<typename TConfig, typename TQualities, typename TStructuralVariantRecord>
+  inline void
+  _assembleConsensus(TConfig const& c, bam_hdr_t* hdr, RefView const* seq, RefView const* sndSeq, SequenceArena const& reads, uint32_t const svid, TQualities& quals, TStructuralVariantRecord& sv) {
+    bool msaSuccess = false;
+    if (reads.size(svid) > 1) {
+      msa(c, reads, svid, sv.consensus);
+      if (alignConsensus(c, hdr, seq, sndSeq, sv)) msaSuccess = true;
+    }
+    if (!msaSuccess) {
+      sv.consensus = "";
+      sv.srSupport = 0;
+      sv.srAlignQuality = 0;
+    } else {
+      // SR support and qualities
+      std::sort(quals.begin(), quals.end());
+      sv.mapq = 0;
+      for(uint32_t i = 0; i < quals.size(); ++i) sv.mapq += quals[i];
+      sv.srSupport = reads.size(svid);
+      sv.srMapQuality = quals[quals.size()/2];
+    }
+  }
+
+  template<typename TConfig, typename TValidRegion, typename TSRStore, typename TSRCache, typename TStructuralVariantRecord>
   inline void
-  assembleSplitReads(TConfig const& c, TValidRegion const& validRegions, TSRStore const& srStore, std::vector<TStructuralVariantRecord>& svs) 
+  assembleSplitReads(TConfig const& c, TValidRegion const& validRegions, TSRStore const& srStore, TSRCache const& srCache, std::vector<TStructuralVariantRecord>& svs) 
   {
     typedef typename TValidRegion::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
     typedef typename TSRStore::value_type TPosReadSV;
 
     // Open file handles
@@ -59,16 +141,13 @@ namespace torali
     TSamFile samfile(c.files.size());
     TIndex idx(c.files.size());
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      idx[file_c] = _hIndex(samfile[file_c]);
     }
-    bam_hdr_t* hdr = sam_hdr_read(samfile[0]);
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
 
     // Reads per SV
-    typedef std::set<std::string> TSequences;
-    typedef std::vector<TSequences> TSVSequences;
-    TSVSequences traStore(svs.size(), TSequences());
+    SequenceArena traStore(svs.size());
     uint32_t maxReadPerSV = 20;
     typedef std::vector<uint8_t> TQualities;
     typedef std::vector<TQualities> TQualVectors;
@@ -79,360 +158,945 @@ namespace torali
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Split-read assembly" << std::endl;
     boost::progress_display show_progress( 2 * hdr->n_targets );
 
-    faidx_t* fai = fai_load(c.genome.string().c_str());
+    faidx_t* fai = _hFaiOpen(c.genome.string());
     for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
       ++show_progress;
       if (validRegions[refIndex].empty()) continue;
       if (srStore[refIndex].empty()) continue;
 
       // Load sequence
-      int32_t seqlen = -1;
-      std::string tname(hdr->target_name[refIndex]);
-      char* seq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr->target_len[refIndex], &seqlen);
+      RefView seq;
+      seq.load(c.genome.string(), fai, hdr->target_name[refIndex]);
       
-      // Collect all split-read pos
-      typedef boost::dynamic_bitset<> TBitSet;
-      TBitSet hits(hdr->target_len[refIndex]);
-      for(typename TPosReadSV::const_iterator it = srStore[refIndex].begin(); it != srStore[refIndex].end(); ++it) hits[it->first.first] = 1;
+      // Collect all split-read pos, only windows around these are fetched from the index
+      std::vector<int32_t> hits;
+      hits.reserve(srStore[refIndex].size());
+      for(typename TPosReadSV::const_iterator it = srStore[refIndex].begin(); it != srStore[refIndex].end(); ++it) hits.push_back(it->first.first);
+      std::sort(hits.begin(), hits.end());
+      hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+      TChrIntervals srWindows;
+      for(uint32_t i = 0; i < hits.size(); ++i) srWindows.insert(TIVal::right_open(hits[i], hits[i] + 1));
 
       // Sequences
-      TSVSequences seqStore(svs.size(), TSequences());
+      SequenceArena seqStore(svs.size());
       TQualVectors qualStore(svs.size(), TQualities());
       
-      // Collect reads from all samples
+      // Collect reads from all samples, control samples do not carry candidate split-reads
       for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-	// Read alignments
-	for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); vRIt != validRegions[refIndex].end(); ++vRIt) {
-	  hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, vRIt->lower(), vRIt->upper());
-	  bam1_t* rec = bam_init1();
-	  while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
-	    if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
-	    if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
-	    if (!hits[rec->core.pos]) continue;
-
-	    // Valid split-read
-	    std::size_t seed = hash_string(bam_get_qname(rec));
-	    typename TPosReadSV::const_iterator it = srStore[refIndex].find(std::make_pair(rec->core.pos, seed));
+	if (c.controlFile[file_c]) continue;
+	
+	// Sequences captured during the scan
+	if ((!srCache.empty()) && (srCache[file_c].complete[refIndex])) {
+	  for(uint32_t i = 0; i < srCache[file_c].reads[refIndex].size(); ++i) {
+	    SplitReadSeq const& srs = srCache[file_c].reads[refIndex][i];
+	    typename TPosReadSV::const_iterator it = srStore[refIndex].find(std::make_pair(srs.pos, srs.seed));
 	    if (it != srStore[refIndex].end()) {
 	      int32_t svid = it->second;
-
-	      // Get the sequence
-	      if (svid == (int32_t) svs[svid].id) {  // Should be always true
-		std::string sequence;
-		sequence.resize(rec->core.l_qseq);
-		uint8_t* seqptr = bam_get_seq(rec);
-		for (int i = 0; i < rec->core.l_qseq; ++i) sequence[i] = "=ACMGRSVTWYHKDBN"[bam_seqi(seqptr, i)];
-
-		// Adjust orientation
-		bool bpPoint = false;
-		if (_translocation(svs[svid].svt)) {
-		  if (rec->core.tid == svs[svid].chr2) bpPoint = true;
-		} else {
-		  // Only relevant for inversions
-		  if (svs[svid].svt == 0) {
-		    if (rec->core.pos + 25 > svs[svid].svStart) bpPoint = true;
-		    else bpPoint = false;
-		  } else if (svs[svid].svt == 1) {
-		    if (rec->core.pos + 25 > svs[svid].svEnd) bpPoint = true;
-		    else bpPoint = false;
-		  }
-		}
-		_adjustOrientation(sequence, bpPoint, svs[svid].svt);
-		
-		// At most n split-reads
-		if (seqStore[svid].size() < maxReadPerSV) {
-		  bool insertSuccess = false;
-		  if (_translocation(svs[svid].svt)) insertSuccess = traStore[svid].insert(sequence).second;
-		  else insertSuccess = seqStore[svid].insert(sequence).second;
-		  // Store qualities
-		  if (insertSuccess) {
-		    if (_translocation(svs[svid].svt)) traQualStore[svid].push_back(rec->core.qual);
-		    else qualStore[svid].push_back(rec->core.qual);
-		  }
-		}
+	      if (svid == (int32_t) svs[svid].id) {
+		std::string sequence(srs.sequence);
+		_collectSplitRead(sequence, refIndex, srs.pos, srs.qual, svid, svs, maxReadPerSV, seqStore, qualStore, traStore, traQualStore);
 	      }
 	    }
 	  }
-	  bam_destroy1(rec);
-          hts_itr_destroy(iter);
+	  continue;
+	}
+	
+	// Read alignments, nearby windows are merged into one region of the multi-region iterator
+	hts_itr_t* iter = _validRegionsIter(idx[file_c], hdr, refIndex, srWindows, 0, hdr->target_len[refIndex]);
+	if (iter == NULL) continue;
+	ValidRegionCursor<TChrIntervals> cursor(validRegions[refIndex]);
+	bam1_t* rec = bam_init1();
+	for(RecordPrefetch prefetch(samfile[file_c], iter); prefetch.next(rec) >= 0;) {
+	  if (!std::binary_search(hits.begin(), hits.end(), (int32_t) rec->core.pos)) continue;
+	  if (cursor.anchor(rec) < 0) continue;
+	  if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
+	  if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
+
+	  // Valid split-read
+	  std::size_t seed = hash_string(bam_get_qname(rec));
+	  typename TPosReadSV::const_iterator it = srStore[refIndex].find(std::make_pair(rec->core.pos, seed));
+	  if (it != srStore[refIndex].end()) {
+	    int32_t svid = it->second;
+
+	    // Get the sequence
+	    if (svid == (int32_t) svs[svid].id) {  // Should be always true
+	      std::string sequence;
+	      sequence.resize(rec->core.l_qseq);
+	      uint8_t* seqptr = bam_get_seq(rec);
+	      for (int i = 0; i < rec->core.l_qseq; ++i) sequence[i] = "=ACMGRSVTWYHKDBN"[bam_seqi(seqptr, i)];
+	      _collectSplitRead(sequence, rec->core.tid, rec->core.pos, rec->core.qual, svid, svs, maxReadPerSV, seqStore, qualStore, traStore, traQualStore);
+	    }
+	  }
 	}
+	bam_destroy1(rec);
+	hts_itr_destroy(iter);
       }
 
-      // Process all SVs on this chromosome
-      for(uint32_t svid = 0; svid < seqStore.size(); ++svid) {
+      // Process all SVs on this chromosome, one task per SV
+      std::vector<uint32_t> chrSV;
+      for(uint32_t svid = 0; svid < svs.size(); ++svid) {
 	if (_translocation(svs[svid].svt)) continue;
 	if (svs[svid].chr != refIndex) continue;
-
-	// MSA
-	bool msaSuccess = false;
-	if (seqStore[svid].size() > 1) {
-	  msa(c, seqStore[svid], svs[svid].consensus);
-	  if (alignConsensus(c, hdr, seq, NULL, svs[svid])) msaSuccess = true;
-	}
-	if (!msaSuccess) {
-	  svs[svid].consensus = "";
-	  svs[svid].srSupport = 0;
-	  svs[svid].srAlignQuality = 0;
-	} else {
-	  // SR support and qualities
-	  std::sort(qualStore[svid].begin(), qualStore[svid].end());
-	  svs[svid].mapq = 0;
-	  for(uint32_t i = 0; i < qualStore[svid].size(); ++i) svs[svid].mapq += qualStore[svid][i];
-	  svs[svid].srSupport = seqStore[svid].size();
-	  svs[svid].srMapQuality = qualStore[svid][qualStore[svid].size()/2];
-	}
+	chrSV.push_back(svid);
+      }
+#pragma omp parallel for schedule(dynamic)
+      for(int32_t k = 0; k < (int32_t) chrSV.size(); ++k) {
+	uint32_t svid = chrSV[k];
+	_assembleConsensus(c, hdr, &seq, NULL, seqStore, svid, qualStore[svid], svs[svid]);
       }
-      // Clean-up
-      if (seq != NULL) free(seq);
     }
 
-    // Process translocations
-    for(int32_t refIndex2 = 0; refIndex2 < hdr->n_targets; ++refIndex2) {
-      ++show_progress;
-      if (validRegions[refIndex2].empty()) continue;
-      char* sndSeq = NULL;
-      for(int32_t refIndex = refIndex2 + 1; refIndex < hdr->n_targets; ++refIndex) {
-	if (validRegions[refIndex].empty()) continue;
-	char* seq = NULL;
-
-	// Iterate SVs
-	for(uint32_t svid = 0; svid < traStore.size(); ++svid) {
-	  if (!_translocation(svs[svid].svt)) continue;
-	  if ((svs[svid].chr != refIndex) || (svs[svid].chr2 != refIndex2)) continue;
-
-	  bool msaSuccess = false;
-	  if (traStore[svid].size() > 1) {
-	    // Lazy loading of references
-	    if (seq == NULL) {
-	      int32_t seqlen = -1;
-	      std::string tname(hdr->target_name[refIndex]);
-	      seq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr->target_len[refIndex], &seqlen);
-	    }
-	    if (sndSeq == NULL) {
-	      int32_t seqlen = -1;
-	      std::string tname(hdr->target_name[refIndex2]);
-	      sndSeq = faidx_fetch_seq(fai, tname.c_str(), 0, hdr->target_len[refIndex2], &seqlen);
-	    }
-	    msa(c, traStore[svid], svs[svid].consensus);
-	    if (alignConsensus(c, hdr, seq, sndSeq, svs[svid])) msaSuccess = true;
-	  }
-	  if (!msaSuccess) {
-	    svs[svid].consensus = "";
-	    svs[svid].srSupport = 0;
-	    svs[svid].srAlignQuality = 0;
-	  } else {
-	    // SR support and qualities
-	    std::sort(traQualStore[svid].begin(), traQualStore[svid].end());
-	    svs[svid].mapq = 0;
-	    for(uint32_t i = 0; i < traQualStore[svid].size(); ++i) svs[svid].mapq += traQualStore[svid][i];
-	    svs[svid].srSupport = traStore[svid].size();
-	    svs[svid].srMapQuality = traQualStore[svid][traQualStore[svid].size()/2];
-	  }
+    // Bucket translocations by chromosome pair, buckets are ordered by (chr2, chr)
+    typedef std::pair<int32_t, int32_t> TChrPair;
+    typedef std::map<TChrPair, std::vector<uint32_t> > TChrPairSVs;
+    TChrPairSVs traBuckets;
+    for(uint32_t svid = 0; svid < svs.size(); ++svid) {
+      if (!_translocation(svs[svid].svt)) continue;
+      if (svs[svid].chr <= svs[svid].chr2) continue;
+      if ((validRegions[svs[svid].chr].empty()) || (validRegions[svs[svid].chr2].empty())) continue;
+      traBuckets[std::make_pair(svs[svid].chr2, svs[svid].chr)].push_back(svid);
+    }
+
+    // Process translocations, the second chromosome is cached across consecutive buckets
+    int32_t sndIndex = -1;
+    RefView sndSeq;
+    for(TChrPairSVs::const_iterator itB = traBuckets.begin(); itB != traBuckets.end(); ++itB) {
+      int32_t refIndex2 = itB->first.first;
+      int32_t refIndex = itB->first.second;
+      std::vector<uint32_t> const& chrSV = itB->second;
+      bool loadSeq = false;
+      for(uint32_t k = 0; k < chrSV.size(); ++k) {
+	if (traStore.size(chrSV[k]) > 1) loadSeq = true;
+      }
+
+      // Lazy loading of references, before the tasks share them
+      RefView seq;
+      if (loadSeq) {
+	seq.load(c.genome.string(), fai, hdr->target_name[refIndex]);
+	if (sndIndex != refIndex2) {
+	  sndSeq.load(c.genome.string(), fai, hdr->target_name[refIndex2]);
+	  sndIndex = refIndex2;
 	}
-	if (seq != NULL) free(seq);
       }
-      if (sndSeq != NULL) free(sndSeq);
+#pragma omp parallel for schedule(dynamic)
+      for(int32_t k = 0; k < (int32_t) chrSV.size(); ++k) {
+	uint32_t svid = chrSV[k];
+	_assembleConsensus(c, hdr, &seq, &sndSeq, traStore, svid, traQualStore[svid], svs[svid]);
+      }
     }
+    show_progress += hdr->n_targets;
 
     // Clean-up
-    fai_destroy(fai);
-    bam_hdr_destroy(hdr);
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    _hFaiClose(fai);
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
 
-      
-  template<typename TConfig, typename TValidRegion, typename TSRStore, typename TSampleLib>
-  inline void
-  scanPEandSR(TConfig const& c, TValidRegion const& validRegions, std::vector<StructuralVariantRecord>& svs, std::vector<StructuralVariantRecord>& srSVs, TSRStore& srStore, TSampleLib& sampleLib)
-  {
-    typedef typename TValidRegion::value_type TChrIntervals;
 
-    // Open file handles
-    typedef std::vector<samFile*> TSamFile;
-    typedef std::vector<hts_idx_t*> TIndex;
-    TSamFile samfile(c.files.size());
-    TIndex idx(c.files.size());
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
+  // Bin size of the depth monitor
+  #ifndef DELLY_DEPTH_BIN
+  #define DELLY_DEPTH_BIN 1000
+  #endif
+
+  // Genomic window of one sample scanned by a single thread
+  struct ScanTask {
+    uint32_t id;
+    uint32_t file_c;
+    int32_t refIndex;
+    int32_t start;
+    int32_t end;
+    uint32_t maxBinReads;
+    uint64_t weight;
+
+    ScanTask(uint32_t const i, uint32_t const f, int32_t const r, int32_t const s, int32_t const e, uint32_t const m, uint64_t const w) : id(i), file_c(f), refIndex(r), start(s), end(e), maxBinReads(m), weight(w) {}
+  };
+
+  // Largest tasks first
+  template<typename TTask>
+  struct SortScanTasks : public std::binary_function<TTask, TTask, bool>
+  {
+    inline bool operator()(TTask const& t1, TTask const& t2) const {
+      return ((t1.weight > t2.weight) || ((t1.weight == t2.weight) && (t1.id < t2.id)));
     }
-    bam_hdr_t* hdr = sam_hdr_read(samfile[0]);
+  };
 
-    // Split-read records
+  // First read of a discordant pair whose mate lies outside of the task
+  struct OpenMate {
+    std::size_t hv;
+    uint8_t qual;
+    int32_t alen;
+
+    OpenMate(std::size_t const h, uint8_t const q, int32_t const a) : hv(h), qual(q), alen(a) {}
+  };
+
+  // Second read of a discordant pair whose mate was not seen in the task
+  struct PendingPair {
+    int32_t svt;
+    int32_t isize;
+    std::size_t hv;
+    BamAlignRecord rec;
+
+    PendingPair(int32_t const s, int32_t const is, std::size_t const h, BamAlignRecord const& r) : svt(s), isize(is), hv(h), rec(r) {}
+  };
+
+  // Evidence collected by a single scan task
+  template<typename TReadBp>
+  struct ScanResult {
+    typedef TReadBp TReadBreakpoints;
+    typedef std::vector<BamAlignStore> TSvtBamRecord;
     typedef std::vector<SRBamRecord> TSRBamRecord;
     typedef std::vector<TSRBamRecord> TSvtSRBamRecord;
-    TSvtSRBamRecord srBR(2 * DELLY_SVT_TRANS, TSRBamRecord());
+    typedef std::vector<std::pair<uint64_t, typename TReadBp::mapped_type> > TReadJunctions;
 
-    // Create bam alignment record vector
-    typedef std::vector<BamAlignRecord> TBamRecord;
-    typedef std::vector<TBamRecord> TSvtBamRecord;
-    TSvtBamRecord bamRecord(2 * DELLY_SVT_TRANS, TBamRecord());
-     
-    // Parse genome, process chromosome by chromosome
-    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
-    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Paired-end and split-read scanning" << std::endl;
-    boost::progress_display show_progress( c.files.size() * hdr->n_targets );
-    // Iterate all samples
-#pragma omp parallel for default(shared)
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      // Inter-chromosomal mate map and alignment length
-      typedef std::pair<uint8_t, int32_t> TQualLen;
-      typedef boost::unordered_map<std::size_t, TQualLen> TMateMap;
-      std::vector<TMateMap> matetra(c.files.size());
+    bool cacheComplete;
+    uint64_t cacheBytes;
+    uint32_t abnormalPairs;
+    uint32_t saSupp;
+    uint32_t noSaSupp;
+    TSvtBamRecord bamRecord;
+    TSvtSRBamRecord srBR;
+    std::vector<OpenMate> openMates;
+    std::vector<PendingPair> pendingPairs;
+    std::vector<SplitReadSeq> splitReads;
+    std::vector<uint64_t> interSeeds;
+    std::vector<uint64_t> unknownSeeds;
+    std::vector<int32_t> delISize;
+    std::vector<EvidenceJunction> evidence;
+    std::vector<int32_t> skippedBins;
+    TReadJunctions readJct;
+    TReadBp readBp;
 
-      // Split-read junctions
-      typedef std::vector<Junction> TJunctionVector;
-      typedef std::map<unsigned, TJunctionVector> TReadBp;
-      TReadBp readBp;
-      
-      // Iterate all chromosomes for that sample
-      for(int32_t refIndex=0; refIndex < (int32_t) hdr->n_targets; ++refIndex) {
-	++show_progress;
+    ScanResult() : cacheComplete(true), cacheBytes(0), abnormalPairs(0), saSupp(0), noSaSupp(0), bamRecord(2 * DELLY_SVT_TRANS, BamAlignStore()) {}
+  };
+
+
+  template<typename TConfig, typename TValidRegion>
+  inline void
+  _scanTasks(TConfig const& c, TValidRegion const& validRegions, bam_hdr_t const* hdr, std::vector<bool> const& scanFile, std::vector<ScanTask>& tasks) {
+    typedef typename TValidRegion::value_type TChrIntervals;
+    
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+      if (!scanFile[file_c]) continue;
+      samFile* samfile = _hOpen(c.files[file_c].string(), c.genome.string(), 0);
+      hts_idx_t* idx = _hIndex(samfile);
+      bool isCram = false;
+      std::string suffix("cram");
+      std::string str(c.files[file_c].string());
+      if ((str.size() >= suffix.size()) && (str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0)) isCram = true;
 
+      // Read cap per depth bin from the length-weighted median read density of all chromosomes
+      uint32_t maxBinReads = 0;
+      if (c.maxDepth > 0) {
+	std::vector<std::pair<double, uint64_t> > density;
+	uint64_t totalLen = 0;
+	for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+	  if ((validRegions[refIndex].empty()) || (!hdr->target_len[refIndex])) continue;
+	  uint64_t mapped = 0;
+	  uint64_t unmapped = 0;
+	  hts_idx_get_stat(idx, refIndex, &mapped, &unmapped);
+	  if (!mapped) continue;
+	  density.push_back(std::make_pair((double) mapped / (double) hdr->target_len[refIndex], (uint64_t) hdr->target_len[refIndex]));
+	  totalLen += hdr->target_len[refIndex];
+	}
+	std::sort(density.begin(), density.end());
+	uint64_t cumLen = 0;
+	for(uint32_t i = 0; i < density.size(); ++i) {
+	  cumLen += density[i].second;
+	  if (2 * cumLen >= totalLen) {
+	    maxBinReads = (uint32_t) std::max(1.0, c.maxDepth * density[i].first * DELLY_DEPTH_BIN);
+	    break;
+	  }
+	}
+	if (!maxBinReads) std::cerr << "Warning: Index lacks read counts, depth monitor disabled for " << c.files[file_c].string() << std::endl;
+      }
+      for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
 	// Any data?
 	if (validRegions[refIndex].empty()) continue;
-	bool nodata = true;
-	std::string suffix("cram");
-	std::string str(c.files[file_c].string());
-	if ((str.size() >= suffix.size()) && (str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0)) nodata = false;
 	uint64_t mapped = 0;
 	uint64_t unmapped = 0;
-	hts_idx_get_stat(idx[file_c], refIndex, &mapped, &unmapped);
-	if (mapped) nodata = false;
-	if (nodata) continue;
-
-	// Intra-chromosomal mate map and alignment length
-	TMateMap mateMap;
-
-	// Read alignments
-	for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); vRIt != validRegions[refIndex].end(); ++vRIt) {
-	  hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, vRIt->lower(), vRIt->upper());
-	  bam1_t* rec = bam_init1();
-	  int32_t lastAlignedPos = 0;
-	  std::set<std::size_t> lastAlignedPosReads;
-	  while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
-	    if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP)) continue;
-	    if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
-
-	    unsigned seed = hash_string(bam_get_qname(rec));
+	hts_idx_get_stat(idx, refIndex, &mapped, &unmapped);
+	if ((!mapped) && (!isCram)) continue;
+
+	// Split chromosome into windows, weighted by the expected number of reads
+	int32_t reflen = hdr->target_len[refIndex];
+	for(int32_t start = 0; start < reflen; start += c.scanWindow) {
+	  int32_t end = std::min(start + c.scanWindow, reflen);
+	  uint64_t validLen = 0;
+	  for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); vRIt != validRegions[refIndex].end(); ++vRIt) {
+	    int32_t istart = std::max((int32_t) vRIt->lower(), start);
+	    int32_t iend = std::min((int32_t) vRIt->upper(), end);
+	    if (istart < iend) validLen += (iend - istart);
+	  }
+	  if (!validLen) continue;
+	  // CRAM indices lack read counts, fall back to the window size
+	  uint64_t weight = validLen;
+	  if (mapped) weight = (mapped * validLen) / reflen + 1;
+	  tasks.push_back(ScanTask(tasks.size(), file_c, refIndex, start, end, maxBinReads, weight));
+	}
+      }
+      _hClose(samfile);
+    }
+  }
+
+
+  // Evidence runs keep the CIGAR operation length of each junction to re-apply the cutoffs later
+  template<typename TConfig, typename TScanResult>
+  inline void
+  _scanJunction(TConfig const& c, TScanResult& res, uint64_t const seed, bam1_t* rec, int32_t const rp, int32_t const sp, bool const scleft, uint32_t const oplen, bool const clip) {
+    if (c.hasEvidence) {
+      Junction jct;
+      if (_readJunction(rec, rp, sp, scleft, jct)) res.evidence.push_back(EvidenceJunction(seed, oplen, clip, jct));
+    } else if (c.saPairing) {
+      Junction jct;
+      if (_readJunction(rec, rp, sp, scleft, jct)) res.readJct.back().second.push_back(jct);
+    } else _insertJunction(res.readBp, seed, rec, rp, sp, scleft);
+  }
+
+  // Split-read SVs of a single read whose junctions are complete
+  template<typename TConfig, typename TReadJunctions, typename TSvtSRBamRecord>
+  inline void
+  _selectSplitRead(TConfig const& c, TReadJunctions& readJct, TSvtSRBamRecord& srBR) {
+    if (readJct.back().second.size() < 2) return;
+    std::sort(readJct.back().second.begin(), readJct.back().second.end(), SortJunction<Junction>());
+    if ((!c.svtcmd) || (c.svtset.find(2) != c.svtset.end())) selectDeletions(c, readJct, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(3) != c.svtset.end())) selectDuplications(c, readJct, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(0) != c.svtset.end()) || (c.svtset.find(1) != c.svtset.end())) selectInversions(c, readJct, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(4) != c.svtset.end())) selectInsertions(c, readJct, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(DELLY_SVT_TRANS) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 1) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 2) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 3) != c.svtset.end())) selectTranslocations(c, readJct, srBR);
+  }
+
+  // Split-read junctions, split-read sequence capture and paired-end clustering of one alignment
+  template<typename TConfig, typename TValidRegion, typename TMateMap, typename TScanResult>
+  inline void
+  _scanRecord(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, LibraryInfo const& lib, bam_hdr_t const* hdr, ScanTask const& task, bam1_t* rec, uint64_t const seed, int32_t& lastAlignedPos, std::set<std::size_t>& lastAlignedPosReads, TMateMap& mateMap, uint64_t& cacheBytes, TScanResult& res)
+  {
+    typedef std::pair<uint8_t, int32_t> TQualLen;
+
+    if (c.saPairing) {
+      res.readJct.back().first = seed;
+      res.readJct.back().second.clear();
+    }
 	    
-	    // SV detection using single-end read
-	    uint32_t rp = rec->core.pos; // reference pointer
-	    uint32_t sp = 0; // sequence pointer
-
-	    // Parse the CIGAR
-	    uint32_t* cigar = bam_get_cigar(rec);
-	    for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
-	      if ((bam_cigar_op(cigar[i]) == BAM_CMATCH) || (bam_cigar_op(cigar[i]) == BAM_CEQUAL) || (bam_cigar_op(cigar[i]) == BAM_CDIFF)) {
-		sp += bam_cigar_oplen(cigar[i]);
-		rp += bam_cigar_oplen(cigar[i]);
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
-		rp += bam_cigar_oplen(cigar[i]);
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, true);
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CINS) {
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, false);
-		sp += bam_cigar_oplen(cigar[i]);
-		if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _insertJunction(readBp, seed, rec, rp, sp, true);
-	      } else if ((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) {
-		int32_t finalsp = sp;
-		bool scleft = false;
-		if (sp == 0) {
-		  finalsp += bam_cigar_oplen(cigar[i]); // Leading soft-clip / hard-clip
-		  scleft = true;
-		}
-		sp += bam_cigar_oplen(cigar[i]);
-		if (bam_cigar_oplen(cigar[i]) > c.minClip) _insertJunction(readBp, seed, rec, rp, finalsp, scleft);
-	      } else if (bam_cigar_op(cigar[i]) == BAM_CREF_SKIP) {
-		rp += bam_cigar_oplen(cigar[i]);
-	      } else {
-		std::cerr << "Warning: Unknown Cigar operation!" << std::endl;
-	      }
-	    }
+    // SV detection using single-end read
+    uint32_t rp = rec->core.pos; // reference pointer
+    uint32_t sp = 0; // sequence pointer
+
+    // Parse the CIGAR
+    std::size_t evBegin = res.evidence.size();
+    bool hasJunction = false;
+    bool hasClipJunction = false;
+    uint32_t* cigar = bam_get_cigar(rec);
+    for (std::size_t i = 0; i < rec->core.n_cigar; ++i) {
+      if ((bam_cigar_op(cigar[i]) == BAM_CMATCH) || (bam_cigar_op(cigar[i]) == BAM_CEQUAL) || (bam_cigar_op(cigar[i]) == BAM_CDIFF)) {
+	sp += bam_cigar_oplen(cigar[i]);
+	rp += bam_cigar_oplen(cigar[i]);
+      } else if (bam_cigar_op(cigar[i]) == BAM_CDEL) {
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) hasJunction = true;
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _scanJunction(c, res, seed, rec, rp, sp, false, bam_cigar_oplen(cigar[i]), false);
+	rp += bam_cigar_oplen(cigar[i]);
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _scanJunction(c, res, seed, rec, rp, sp, true, bam_cigar_oplen(cigar[i]), false);
+      } else if (bam_cigar_op(cigar[i]) == BAM_CINS) {
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) hasJunction = true;
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _scanJunction(c, res, seed, rec, rp, sp, false, bam_cigar_oplen(cigar[i]), false);
+	sp += bam_cigar_oplen(cigar[i]);
+	if (bam_cigar_oplen(cigar[i]) > c.minRefSep) _scanJunction(c, res, seed, rec, rp, sp, true, bam_cigar_oplen(cigar[i]), false);
+      } else if ((bam_cigar_op(cigar[i]) == BAM_CSOFT_CLIP) || (bam_cigar_op(cigar[i]) == BAM_CHARD_CLIP)) {
+	int32_t finalsp = sp;
+	bool scleft = false;
+	if (sp == 0) {
+	  finalsp += bam_cigar_oplen(cigar[i]); // Leading soft-clip / hard-clip
+	  scleft = true;
+	}
+	sp += bam_cigar_oplen(cigar[i]);
+	if (bam_cigar_oplen(cigar[i]) > c.minClip) hasClipJunction = true;
+	if (bam_cigar_oplen(cigar[i]) > c.minClip) _scanJunction(c, res, seed, rec, rp, finalsp, scleft, bam_cigar_oplen(cigar[i]), true);
+      } else if (bam_cigar_op(cigar[i]) == BAM_CREF_SKIP) {
+	rp += bam_cigar_oplen(cigar[i]);
+      } else {
+	std::cerr << "Warning: Unknown Cigar operation!" << std::endl;
+      }
+    }
+    if (hasClipJunction) hasJunction = true;
+
+    // Split-read partner possibly on another chromosome?
+    uint8_t* saptr = bam_aux_get(rec, "SA");
+    if ((!c.saPairing) && (rec->core.flag & BAM_FSUPPLEMENTARY)) {
+      if (saptr) ++res.saSupp;
+      else ++res.noSaSupp;
+    }
+    if (c.saPairing) {
+      if ((hasClipJunction) && (saptr != NULL)) _saJunctions(c, validRegions, hdr, saptr, res.readJct.back().second);
+      _selectSplitRead(c, res.readJct, res.srBR);
+    } else if (hasClipJunction) {
+      if (c.hasEvidence) {
+	uint8_t sa = 0;
+	if (saptr != NULL) sa = _interChrSA(saptr, hdr->target_name[task.refIndex]) ? 2 : 1;
+	for(std::size_t i = evBegin; i < res.evidence.size(); ++i) res.evidence[i].sa = sa;
+      }
+      else if (saptr == NULL) res.unknownSeeds.push_back(seed);
+      else if (_interChrSA(saptr, hdr->target_name[task.refIndex])) res.interSeeds.push_back(seed);
+    }
+
+    // Capture split-read sequence for the assembly
+    if ((c.fusedScan) && (res.cacheComplete) && (hasJunction) && (!(rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)))) {
+      uint64_t usedBytes = 0;
+      uint64_t recBytes = sizeof(SplitReadSeq) + rec->core.l_qseq;
+#pragma omp atomic capture
+      usedBytes = cacheBytes += recBytes;
+      if (usedBytes > (uint64_t) c.fusedMemory * 1024 * 1024) {
+	// Buffer exhausted, this window needs a second pass and releases its share of the budget
+	uint64_t freedBytes = res.cacheBytes + recBytes;
+#pragma omp atomic
+	cacheBytes -= freedBytes;
+	res.cacheComplete = false;
+	res.cacheBytes = 0;
+	std::vector<SplitReadSeq>().swap(res.splitReads);
+      } else {
+	res.cacheBytes += recBytes;
+	res.splitReads.push_back(SplitReadSeq(rec->core.pos, rec->core.qual, seed));
+	std::string& sequence = res.splitReads.back().sequence;
+	sequence.resize(rec->core.l_qseq);
+	uint8_t* seqptr = bam_get_seq(rec);
+	for (int i = 0; i < rec->core.l_qseq; ++i) sequence[i] = "=ACMGRSVTWYHKDBN"[bam_seqi(seqptr, i)];
+      }
+    }
 	    
-	    // Paired-end clustering
-	    if (rec->core.flag & BAM_FPAIRED) {
-	      // Single-end library
-	      if (sampleLib[file_c].median == 0) continue; // Single-end library
-
-	      // Secondary/supplementary alignments, mate unmapped or blacklisted chr
-	      if (rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) continue;
-	      if ((rec->core.mtid<0) || (rec->core.flag & BAM_FMUNMAP)) continue;
-	      if (validRegions[rec->core.mtid].empty()) continue;
-	      if ((_translocation(rec)) && (rec->core.qual < c.minTraQual)) continue;
-
-	      // SV type	      
-	      int32_t svt = _isizeMappingPos(rec, sampleLib[file_c].maxISizeCutoff);
-	      if (svt == -1) continue;
-	      if ((c.svtcmd) && (c.svtset.find(svt) == c.svtset.end())) continue;
-
-	      // Check library-specific insert size for deletions
-	      if ((svt == 2) && (sampleLib[file_c].maxISizeCutoff > std::abs(rec->core.isize))) continue;
+    // Paired-end clustering
+    if (rec->core.flag & BAM_FPAIRED) {
+      // Single-end library
+      if (lib.median == 0) return; // Single-end library
+
+      // Secondary/supplementary alignments, mate unmapped or blacklisted chr
+      if (rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) return;
+      if ((rec->core.mtid<0) || (rec->core.flag & BAM_FMUNMAP)) return;
+      if (validRegions[rec->core.mtid].empty()) return;
+      if ((_translocation(rec)) && (rec->core.qual < c.minTraQual)) return;
+
+      // SV type	      
+      int32_t svt = _isizeMappingPos(rec, lib.maxISizeCutoff);
+      if (svt == -1) return;
+      if ((c.svtcmd) && (c.svtset.find(svt) == c.svtset.end())) return;
+
+      // Check library-specific insert size for deletions
+      if ((svt == 2) && (lib.maxISizeCutoff > std::abs(rec->core.isize))) return;
+
+      // Mate beyond the shard margin, its mapping quality and alignment length come from the MQ and MC tags
+      if ((!boost::icl::contains(scanRegions[rec->core.mtid], (uint32_t) rec->core.mpos)) && (boost::icl::contains(validRegions[rec->core.mtid], (uint32_t) rec->core.mpos))) {
+	uint8_t* mqptr = bam_aux_get(rec, "MQ");
+	uint8_t mateQual = (mqptr != NULL) ? (uint8_t) bam_aux2i(mqptr) : rec->core.qual;
+	if (mateQual < c.minMapQual) return;
+	if ((_translocation(rec)) && (mateQual < c.minTraQual)) return;
+	uint8_t pairQuality = std::min(mateQual, (uint8_t) rec->core.qual);
+	// Records are stored from the second read of the pair
+	if (_firstPairObs(rec, lastAlignedPosReads)) res.bamRecord[svt].push_back(BamAlignRecord(rec->core.mtid, rec->core.mpos, rec->core.tid, rec->core.pos, pairQuality, mateAlignmentLength(rec), alignmentLength(rec), task.file_c));
+	else res.bamRecord[svt].push_back(BamAlignRecord(rec, pairQuality, alignmentLength(rec), mateAlignmentLength(rec), task.file_c));
+	if ((c.hasEvidence) && (svt == 2)) res.delISize.push_back(rec->core.isize);
+	++res.abnormalPairs;
+	return;
+      }
 	      
-	      // Clean-up the read store for identical alignment positions
-	      if (rec->core.pos > lastAlignedPos) {
-		lastAlignedPosReads.clear();
-		lastAlignedPos = rec->core.pos;
-	      }
+      // Clean-up the read store for identical alignment positions
+      if (rec->core.pos > lastAlignedPos) {
+	lastAlignedPosReads.clear();
+	lastAlignedPos = rec->core.pos;
+      }
 	      
-	      // Get or store the mapping quality for the partner
-	      if (_firstPairObs(rec, lastAlignedPosReads)) {
-		// First read
-		lastAlignedPosReads.insert(seed);
-		std::size_t hv = hash_pair(rec);
-		if (_translocation(svt)) matetra[file_c][hv]= std::make_pair((uint8_t) rec->core.qual, alignmentLength(rec));
-		else mateMap[hv]= std::make_pair((uint8_t) rec->core.qual, alignmentLength(rec));
-	      } else {
-		// Second read
-		std::size_t hv = hash_pair_mate(rec);
-		int32_t alenmate = 0;
-		uint8_t pairQuality = 0;
-	        if (_translocation(svt)) {
-		  // Inter-chromosomal
-		  if ((matetra[file_c].find(hv) == matetra[file_c].end()) || (!matetra[file_c][hv].first)) continue; // Mate discarded
-		  TQualLen p = matetra[file_c][hv];
-		  pairQuality = std::min((uint8_t) p.first, (uint8_t) rec->core.qual);
-		  alenmate = p.second;
-		  matetra[file_c][hv].first = 0;
-		} else {
-		  // Intra-chromosomal
-		  if ((mateMap.find(hv) == mateMap.end()) || (!mateMap[hv].first)) continue; // Mate discarded
-		  TQualLen p = mateMap[hv];
-		  pairQuality = std::min((uint8_t) p.first, (uint8_t) rec->core.qual);
-		  alenmate = p.second;
-		  mateMap[hv].first = 0;
-		}
+      // Get or store the mapping quality for the partner
+      if (_firstPairObs(rec, lastAlignedPosReads)) {
+	// First read
+	lastAlignedPosReads.insert(seed);
+	std::size_t hv = hash_pair(rec);
+	mateMap.insert(hv, std::make_pair((uint8_t) rec->core.qual, alignmentLength(rec)));
+      } else {
+	// Second read
+	std::size_t hv = hash_pair_mate(rec);
+	TQualLen mate;
+	if (!mateMap.take(hv, mate)) {
+	  // Mate in another task or discarded, pair after the scan
+	  res.pendingPairs.push_back(PendingPair(svt, rec->core.isize, hv, BamAlignRecord(rec, rec->core.qual, alignmentLength(rec), 0, task.file_c)));
+	  return;
+	}
+	if (!mate.first) return; // Mate discarded
+	uint8_t pairQuality = std::min((uint8_t) mate.first, (uint8_t) rec->core.qual);
+	res.bamRecord[svt].push_back(BamAlignRecord(rec, pairQuality, alignmentLength(rec), mate.second, task.file_c));
+	if ((c.hasEvidence) && (svt == 2)) res.delISize.push_back(rec->core.isize);
+	++res.abnormalPairs;
+      }
+    }
+  }
+
+  // Process one 1kbp depth bin. Bins within the cap are processed from the buffer, deeper bins are read again and keep reads whose name hash
+  // is below cap / bin reads, so the decision depends on the read name and the depth of the bin only.
+  template<typename TConfig, typename TValidRegion, typename TMateMap, typename TScanResult>
+  inline void
+  _scanDepthBin(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, LibraryInfo const& lib, bam_hdr_t const* hdr, ScanTask const& task, int32_t const bin, uint32_t const binReads, std::vector<bam1_t*> const& binBuf, uint32_t const nbuf, samFile*& binfile, int32_t& lastAlignedPos, std::set<std::size_t>& lastAlignedPosReads, TMateMap& mateMap, uint64_t& cacheBytes, TScanResult& res)
+  {
+    typedef typename TValidRegion::value_type TChrIntervals;
+
+    if (binReads <= task.maxBinReads) {
+      for(uint32_t i = 0; i < nbuf; ++i) _scanRecord(c, validRegions, scanRegions, lib, hdr, task, binBuf[i], hash_string(bam_get_qname(binBuf[i])), lastAlignedPos, lastAlignedPosReads, mateMap, cacheBytes, res);
+      return;
+    }
+    uint64_t binKeep = (uint64_t) (((double) task.maxBinReads / (double) binReads) * 18446744073709551615.0);
+    res.skippedBins.push_back(bin);
+
+    // The scan handle is busy with the prefetcher
+    if (binfile == NULL) binfile = _hOpen(c.files[task.file_c].string(), c.genome.string(), c.fusedScan ? (DELLY_CRAM_SVSCAN | SAM_SEQ) : DELLY_CRAM_SVSCAN);
+    hts_idx_t* idx = _hIndex(binfile);
+    if (idx == NULL) return;
+    int32_t binStart = std::max(task.start, bin * DELLY_DEPTH_BIN);
+    int32_t binEnd = std::min(task.end, (bin + 1) * DELLY_DEPTH_BIN);
+    hts_itr_t* iter = sam_itr_queryi(idx, task.refIndex, binStart, binEnd);
+    if (iter == NULL) return;
+    ValidRegionCursor<TChrIntervals> cursor(scanRegions[task.refIndex]);
+    bam1_t* rec = bam_init1();
+    while (_ioItrNext(binfile, iter, rec) >= 0) {
+      if (rec->core.pos >= binEnd) break;
+      int32_t anchor = cursor.anchor(rec);
+      if ((anchor < binStart) || (anchor >= binEnd)) continue;
+      if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP)) continue;
+      if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
+      if ((c.saPairing) && (rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) && (!_ownSplitAlignment(c, hdr, validRegions, scanRegions, rec))) continue; // Counted in the first pass
+      uint64_t seed = hash_string(bam_get_qname(rec));
+      if (seed >= binKeep) continue;
+      _scanRecord(c, validRegions, scanRegions, lib, hdr, task, rec, seed, lastAlignedPos, lastAlignedPosReads, mateMap, cacheBytes, res);
+    }
+    bam_destroy1(rec);
+    hts_itr_destroy(iter);
+  }
+
+  template<typename TConfig, typename TValidRegion, typename TScanResult>
+  inline void
+  _scanPEandSRTask(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, LibraryInfo const& lib, bam_hdr_t const* hdr, samFile* samfile, hts_idx_t* idx, ScanTask const& task, uint64_t& cacheBytes, TScanResult& res)
+  {
+    typedef typename TValidRegion::value_type TChrIntervals;
+
+    // Intra-task mate map and alignment length
+    typedef MateTable<std::pair<uint8_t, int32_t> > TMateMap;
+    TMateMap mateMap;
+
+    // Read alignments of all valid intervals in the window with one iterator
+    hts_itr_t* iter = _validRegionsIter(idx, hdr, task.refIndex, scanRegions[task.refIndex], task.start, task.end);
+    if (iter == NULL) return;
+    ValidRegionCursor<TChrIntervals> cursor(scanRegions[task.refIndex]);
+    bam1_t* rec = bam_init1();
+    int32_t lastAlignedPos = 0;
+    std::set<std::size_t> lastAlignedPosReads;
+    int32_t depthBin = -1;
+    uint32_t binReads = 0;
+    std::vector<bam1_t*> binBuf;
+    uint32_t nbuf = 0;
+    samFile* binfile = NULL;
+    if (c.saPairing) {
+      res.readJct.resize(1);
+      res.srBR.resize(2 * DELLY_SVT_TRANS);
+    }
+    for(RecordPrefetch prefetch(samfile, iter); prefetch.next(rec) >= 0;) {
+      // Reads first overlapping a valid interval in the previous window have been processed there
+      int32_t anchor = cursor.anchor(rec);
+      if ((anchor < task.start) || (anchor >= task.end)) continue;
+      if (rec->core.flag & (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP)) continue;
+      if ((rec->core.qual < c.minMapQual) || (rec->core.tid<0)) continue;
+
+      // SA pairing, the split alignments are reconstructed from the primary record or, beyond the shard margin, from one supplementary record
+      if ((c.saPairing) && (rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))) {
+	if (rec->core.flag & BAM_FSUPPLEMENTARY) {
+	  if (bam_aux_get(rec, "SA")) ++res.saSupp;
+	  else ++res.noSaSupp;
+	}
+	if (!_ownSplitAlignment(c, hdr, validRegions, scanRegions, rec)) continue;
+      }
+
+      // Depth monitor, reads of a bin are buffered up to the cap. Bins are cut at task boundaries, reads are binned by the same anchor as tasks
+      if (task.maxBinReads) {
+	int32_t bin = anchor / DELLY_DEPTH_BIN;
+	if (bin != depthBin) {
+	  if (depthBin != -1) _scanDepthBin(c, validRegions, scanRegions, lib, hdr, task, depthBin, binReads, binBuf, nbuf, binfile, lastAlignedPos, lastAlignedPosReads, mateMap, cacheBytes, res);
+	  depthBin = bin;
+	  binReads = 0;
+	  nbuf = 0;
+	}
+	// Only primary alignments count towards the cap
+	if (!(rec->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))) ++binReads;
+	if (binReads <= task.maxBinReads) {
+	  if (nbuf == binBuf.size()) binBuf.push_back(bam_init1());
+	  bam_copy1(binBuf[nbuf++], rec);
+	}
+	continue;
+      }
+      _scanRecord(c, validRegions, scanRegions, lib, hdr, task, rec, hash_string(bam_get_qname(rec)), lastAlignedPos, lastAlignedPosReads, mateMap, cacheBytes, res);
+    }
+    if (depthBin != -1) _scanDepthBin(c, validRegions, scanRegions, lib, hdr, task, depthBin, binReads, binBuf, nbuf, binfile, lastAlignedPos, lastAlignedPosReads, mateMap, cacheBytes, res);
+    for(uint32_t i = 0; i < binBuf.size(); ++i) bam_destroy1(binBuf[i]);
+    _hClose(binfile);
+    bam_destroy1(rec);
+    hts_itr_destroy(iter);
+
+    // Mates in another window or on another chromosome are paired after the scan
+    for(typename TMateMap::TSlots::const_iterator it = mateMap.slots.begin(); it != mateMap.slots.end(); ++it) {
+      if (it->key) res.openMates.push_back(OpenMate(it->key, it->value.first, it->value.second));
+    }
+  }
+
+
+  template<typename TConfig, typename TScanResults>
+  inline void
+  _flushJunctions(TConfig const& c, uint32_t const tbeg, uint32_t const tend, TScanResults& results) {
+    typedef typename TScanResults::value_type TScanResult;
+    typedef typename TScanResult::TReadBreakpoints TReadBp;
+    typedef typename TReadBp::mapped_type TJunctionVector;
+    
+    // Merge all windows of the chromosome
+    TReadBp readBp;
+    std::vector<uint64_t> candidates;
+    uint32_t saSupp = 0;
+    uint32_t noSaSupp = 0;
+    for(uint32_t t = tbeg; t < tend; ++t) {
+      for(typename TReadBp::iterator it = results[t].readBp.begin(); it != results[t].readBp.end(); ++it) {
+	TJunctionVector& jv = readBp[it->first];
+	jv.insert(jv.end(), it->second.begin(), it->second.end());
+      }
+      TReadBp().swap(results[t].readBp);
+      candidates.insert(candidates.end(), results[t].interSeeds.begin(), results[t].interSeeds.end());
+      std::vector<uint64_t>().swap(results[t].interSeeds);
+      saSupp += results[t].saSupp;
+      noSaSupp += results[t].noSaSupp;
+    }
+    // Without SA tags every clipped read may continue on another chromosome
+    bool saTagged = ((saSupp) && (!noSaSupp));
+    for(uint32_t t = tbeg; t < tend; ++t) {
+      if (!saTagged) candidates.insert(candidates.end(), results[t].unknownSeeds.begin(), results[t].unknownSeeds.end());
+      std::vector<uint64_t>().swap(results[t].unknownSeeds);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    
+    // Intra-chromosomal split-read SVs
+    for(typename TReadBp::iterator it = readBp.begin(); it != readBp.end(); ++it) {
+      std::sort(it->second.begin(), it->second.end(), SortJunction<Junction>());
+    }
+    typename TScanResult::TSvtSRBamRecord& srBR = results[tbeg].srBR;
+    srBR.resize(2 * DELLY_SVT_TRANS);
+    if ((!c.svtcmd) || (c.svtset.find(2) != c.svtset.end())) selectDeletions(c, readBp, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(3) != c.svtset.end())) selectDuplications(c, readBp, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(0) != c.svtset.end()) || (c.svtset.find(1) != c.svtset.end())) selectInversions(c, readBp, srBR);
+    if ((!c.svtcmd) || (c.svtset.find(4) != c.svtset.end())) selectInsertions(c, readBp, srBR);
+
+    // Keep only split-reads that may continue on another chromosome
+    for(typename TReadBp::iterator it = readBp.begin(); it != readBp.end(); ++it) {
+      if (std::binary_search(candidates.begin(), candidates.end(), it->first)) results[tbeg].readBp.insert(results[tbeg].readBp.end(), *it);
+    }
+  }
+
+      
+  // Report the bins skipped by the depth monitor, adjacent bins are merged
+  template<typename TConfig, typename TScanResults>
+  inline void
+  _writeSkippedBins(TConfig const& c, bam_hdr_t const* hdr, std::vector<ScanTask> const& tasks, TScanResults const& results) {
+    std::ofstream ofile;
+    if (c.hasSkipFile) ofile.open(c.skipfile.string().c_str());
+    uint64_t skipped = 0;
+    for(uint32_t t = 0; t < tasks.size(); ++t) {
+      std::vector<int32_t> const& bins = results[t].skippedBins;
+      for(uint32_t i = 0; i < bins.size();) {
+	uint32_t j = i + 1;
+	while ((j < bins.size()) && (bins[j] == bins[j-1] + 1)) ++j;
+	if (c.hasSkipFile) ofile << hdr->target_name[tasks[t].refIndex] << '\t' << bins[i] * DELLY_DEPTH_BIN << '\t' << std::min((int64_t) bins[j-1] * DELLY_DEPTH_BIN + DELLY_DEPTH_BIN, (int64_t) hdr->target_len[tasks[t].refIndex]) << '\t' << c.sampleName[tasks[t].file_c] << std::endl;
+	skipped += (j - i);
+	i = j;
+      }
+    }
+    if (c.hasSkipFile) ofile.close();
+    if (skipped) std::cout << "Depth monitor: " << skipped << " high-depth bins down-sampled" << std::endl;
+  }
+
+      
+  template<typename TConfig, typename TValidRegion, typename TSRCache, typename TSampleLib, typename TSvtBamRecord, typename TSvtSRBamRecord>
+  inline void
+  _scanSamples(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, bam_hdr_t const* hdr, std::vector<bool> const& scanFile, TSRCache& srCache, TSampleLib& sampleLib, std::vector<TSvtBamRecord>& fileBamRecord, std::vector<TSvtSRBamRecord>& fileSRBR)
+  {
+    typedef std::vector<SRBamRecord> TSRBamRecord;
 
+    // Split-read junctions
+    typedef std::vector<Junction> TJunctionVector;
+    typedef std::map<uint64_t, TJunctionVector> TReadBp;
+
+    // Split samples into genomic windows, largest first
+    typedef std::vector<ScanTask> TScanTasks;
+    TScanTasks tasks;
+    _scanTasks(c, scanRegions, hdr, scanFile, tasks);
+    TScanTasks schedule(tasks);
+    std::sort(schedule.begin(), schedule.end(), SortScanTasks<ScanTask>());
+    typedef ScanResult<TReadBp> TScanResult;
+    std::vector<TScanResult> results(tasks.size(), TScanResult());
+    uint64_t cacheBytes = 0;
+
+    // Windows of a chromosome left to scan, junctions are flushed after the last one
+    std::vector<uint32_t> chrBegin(tasks.size(), 0);
+    std::vector<uint32_t> chrEnd(tasks.size(), 0);
+    std::vector<uint32_t> chrPending(tasks.size(), 0);
+    for(uint32_t t = 0; t < tasks.size(); ++t) {
+      if ((t > 0) && (tasks[t].file_c == tasks[t-1].file_c) && (tasks[t].refIndex == tasks[t-1].refIndex)) chrBegin[t] = chrBegin[t-1];
+      else chrBegin[t] = t;
+      ++chrPending[chrBegin[t]];
+    }
+    for(uint32_t t = 0; t < tasks.size(); ++t) chrEnd[t] = chrBegin[t] + chrPending[chrBegin[t]];
+
+    // One borrowed alignment file per thread
+#ifdef OPENMP
+    int32_t nthreads = omp_get_max_threads();
+#else
+    int32_t nthreads = 1;
+#endif
+    std::vector<int32_t> openFile(nthreads, -1);
+    std::vector<samFile*> samfile(nthreads, (samFile*) NULL);
+    std::vector<hts_idx_t*> idx(nthreads, (hts_idx_t*) NULL);
+
+
+    // Parse genome, idle threads pick up the next largest window
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+    std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Paired-end and split-read scanning" << std::endl;
+    boost::progress_display show_progress( schedule.size() );
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+    for(uint32_t t = 0; t < schedule.size(); ++t) {
+#ifdef OPENMP
+      int32_t thread = omp_get_thread_num();
+#else
+      int32_t thread = 0;
+#endif
+      uint32_t file_c = schedule[t].file_c;
+      if (openFile[thread] != (int32_t) file_c) {
+	_hClose(samfile[thread]);
+	samfile[thread] = _hOpen(c.files[file_c].string(), c.genome.string(), c.fusedScan ? (DELLY_CRAM_SVSCAN | SAM_SEQ) : DELLY_CRAM_SVSCAN);
+	idx[thread] = _hIndex(samfile[thread]);
+	openFile[thread] = file_c;
+      }
+      _scanPEandSRTask(c, validRegions, scanRegions, sampleLib[file_c], hdr, samfile[thread], idx[thread], schedule[t], cacheBytes, results[schedule[t].id]);
+      uint32_t tbeg = chrBegin[schedule[t].id];
+      bool chrDone = false;
 #pragma omp critical
-		{
-		  bamRecord[svt].push_back(BamAlignRecord(rec, pairQuality, alignmentLength(rec), alenmate, sampleLib[file_c].median, sampleLib[file_c].mad, sampleLib[file_c].maxNormalISize));
-		}
-		++sampleLib[file_c].abnormal_pairs;
-	      }
-	    }
+      {
+	++show_progress;
+	if (--chrPending[tbeg] == 0) chrDone = true;
+      }
+      if ((chrDone) && (!c.hasEvidence) && (!c.saPairing)) _flushJunctions(c, tbeg, chrEnd[tbeg], results);
+    }
+    for(int32_t thread = 0; thread < nthreads; ++thread) _hClose(samfile[thread]);
+
+    // Supplementary alignments without SA tag cannot be paired with their primary alignment
+    if (c.saPairing) {
+      uint64_t noSaSupp = 0;
+      for(uint32_t t = 0; t < tasks.size(); ++t) noSaSupp += results[t].noSaSupp;
+      if (noSaSupp) std::cerr << "Warning: " << noSaSupp << " supplementary alignments without SA tag were skipped by --sa-pairing" << std::endl;
+    }
+
+    // High-depth bins
+    if (c.maxDepth > 0) _writeSkippedBins(c, hdr, tasks, results);
+
+    // Task range of each sample
+    std::vector<uint32_t> taskBegin(c.files.size() + 1, tasks.size());
+    for(int32_t t = (int32_t) tasks.size() - 1; t >= 0; --t) taskBegin[tasks[t].file_c] = t;
+    for(int32_t file_c = (int32_t) c.files.size() - 1; file_c >= 0; --file_c) taskBegin[file_c] = std::min(taskBegin[file_c], taskBegin[file_c + 1]);
+
+    // Merge task results in genomic order and classify split-reads, one buffer per sample
+    if (c.fusedScan) {
+      srCache.resize(c.files.size(), SplitReadCache(hdr->n_targets));
+      for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+	if (scanFile[file_c]) {
+	  srCache[file_c] = SplitReadCache(hdr->n_targets);
+	  // Split-reads of partially scanned chromosomes may have their primary alignment beyond the shard margin
+	  for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+	    if (scanRegions[refIndex] != validRegions[refIndex]) srCache[file_c].complete[refIndex] = 0;
+	  }
+	}
+      }
+    }
+    uint64_t regionHash = 0;
+    if (c.hasEvidence) regionHash = _evidenceRegionHash(hdr, scanRegions);
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+      if (!scanFile[file_c]) continue;
+      typedef std::pair<uint8_t, int32_t> TQualLen;
+      typedef MateTable<TQualLen> TMateMap;
+      TMateMap mateMap;
+      TReadBp readBp;
+      TSvtBamRecord& bamRec = fileBamRecord[file_c];
+      bamRec.resize(2 * DELLY_SVT_TRANS, BamAlignStore());
+      TSvtSRBamRecord& srRec = fileSRBR[file_c];
+      srRec.resize(2 * DELLY_SVT_TRANS, TSRBamRecord());
+      std::vector<int32_t> delISize;
+      std::vector<uint32_t> saSupp;
+      std::vector<uint32_t> noSaSupp;
+      std::vector<std::vector<EvidenceJunction> > evJct;
+      if (c.hasEvidence) {
+	saSupp.resize(hdr->n_targets, 0);
+	noSaSupp.resize(hdr->n_targets, 0);
+	evJct.resize(hdr->n_targets);
+      }
+      for(uint32_t t = taskBegin[file_c]; t < taskBegin[file_c + 1]; ++t) {
+	for(uint32_t svt = 0; svt < bamRec.size(); ++svt) {
+	  bamRec[svt].append(results[t].bamRecord[svt]);
+	  BamAlignStore().swap(results[t].bamRecord[svt]);
+	}
+	sampleLib[file_c].abnormal_pairs += results[t].abnormalPairs;
+	for(uint32_t i = 0; i < results[t].openMates.size(); ++i) mateMap.insert(results[t].openMates[i].hv, std::make_pair(results[t].openMates[i].qual, results[t].openMates[i].alen));
+	std::vector<OpenMate>().swap(results[t].openMates);
+	for(uint32_t svt = 0; svt < results[t].srBR.size(); ++svt) {
+	  srRec[svt].insert(srRec[svt].end(), results[t].srBR[svt].begin(), results[t].srBR[svt].end());
+	}
+	TSvtSRBamRecord().swap(results[t].srBR);
+	for(typename TReadBp::iterator it = results[t].readBp.begin(); it != results[t].readBp.end(); ++it) {
+	  TJunctionVector& jv = readBp[it->first];
+	  jv.insert(jv.end(), it->second.begin(), it->second.end());
+	}
+	TReadBp().swap(results[t].readBp);
+	if (c.hasEvidence) {
+	  int32_t refIndex = tasks[t].refIndex;
+	  delISize.insert(delISize.end(), results[t].delISize.begin(), results[t].delISize.end());
+	  std::vector<int32_t>().swap(results[t].delISize);
+	  saSupp[refIndex] += results[t].saSupp;
+	  noSaSupp[refIndex] += results[t].noSaSupp;
+	  evJct[refIndex].insert(evJct[refIndex].end(), results[t].evidence.begin(), results[t].evidence.end());
+	  std::vector<EvidenceJunction>().swap(results[t].evidence);
+	}
+	if (c.fusedScan) {
+	  int32_t refIndex = tasks[t].refIndex;
+	  if (!results[t].cacheComplete) srCache[file_c].complete[refIndex] = 0;
+	  if (srCache[file_c].complete[refIndex]) srCache[file_c].reads[refIndex].insert(srCache[file_c].reads[refIndex].end(), results[t].splitReads.begin(), results[t].splitReads.end());
+	  else {
+	    // Chromosome falls back to the second pass, its captured reads no longer count
+	    uint64_t freedBytes = results[t].cacheBytes;
+	    for(uint32_t i = 0; i < srCache[file_c].reads[refIndex].size(); ++i) freedBytes += sizeof(SplitReadSeq) + srCache[file_c].reads[refIndex][i].sequence.size();
+#pragma omp atomic
+	    cacheBytes -= freedBytes;
+	    results[t].cacheBytes = 0;
+	    std::vector<SplitReadSeq>().swap(srCache[file_c].reads[refIndex]);
 	  }
-	  bam_destroy1(rec);
-	  hts_itr_destroy(iter);
+	  std::vector<SplitReadSeq>().swap(results[t].splitReads);
+	}
+      }
+
+      // Pair reads across task boundaries
+      for(uint32_t t = taskBegin[file_c]; t < taskBegin[file_c + 1]; ++t) {
+	for(uint32_t i = 0; i < results[t].pendingPairs.size(); ++i) {
+	  PendingPair& pp = results[t].pendingPairs[i];
+	  TQualLen mate;
+	  if ((!mateMap.take(pp.hv, mate)) || (!mate.first)) continue; // Mate discarded
+	  pp.rec.MapQuality = std::min((uint8_t) mate.first, (uint8_t) pp.rec.MapQuality);
+	  pp.rec.malen = mate.second;
+	  bamRec[pp.svt].push_back(pp.rec);
+	  if ((c.hasEvidence) && (pp.svt == 2)) delISize.push_back(pp.isize);
+	  ++sampleLib[file_c].abnormal_pairs;
 	}
+	std::vector<PendingPair>().swap(results[t].pendingPairs);
       }
 
-      // Process all junctions for this BAM file
+      // Evidence runs store all records, the cutoffs of the run are applied on loading
+      if (c.hasEvidence) {
+	_writeEvidence(c, file_c, regionHash, hdr, sampleLib[file_c], saSupp, noSaSupp, evJct, bamRec, delISize);
+	TSvtBamRecord(2 * DELLY_SVT_TRANS, BamAlignStore()).swap(bamRec);
+	continue;
+      }
+
+      // Inter-chromosomal split-reads left over after the chromosome flushes
       for(typename TReadBp::iterator it = readBp.begin(); it != readBp.end(); ++it) {
 	std::sort(it->second.begin(), it->second.end(), SortJunction<Junction>());
       }
-	
-      // Collect split-read SVs
-#pragma omp critical
-      {
-	if ((!c.svtcmd) || (c.svtset.find(2) != c.svtset.end())) selectDeletions(c, readBp, srBR);
-	if ((!c.svtcmd) || (c.svtset.find(3) != c.svtset.end())) selectDuplications(c, readBp, srBR);
-	if ((!c.svtcmd) || (c.svtset.find(0) != c.svtset.end()) || (c.svtset.find(1) != c.svtset.end())) selectInversions(c, readBp, srBR);
-	if ((!c.svtcmd) || (c.svtset.find(4) != c.svtset.end())) selectInsertions(c, readBp, srBR);
-	if ((!c.svtcmd) || (c.svtset.find(DELLY_SVT_TRANS) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 1) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 2) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 3) != c.svtset.end())) selectTranslocations(c, readBp, srBR);
+      if ((!c.svtcmd) || (c.svtset.find(DELLY_SVT_TRANS) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 1) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 2) != c.svtset.end()) || (c.svtset.find(DELLY_SVT_TRANS + 3) != c.svtset.end())) selectTranslocations(c, readBp, srRec);
+    }
+  }
+
+
+  // Call from the evidence sidecars, samples without a usable sidecar are scanned once to create it
+  template<typename TConfig, typename TValidRegion, typename TSRCache, typename TSampleLib, typename TSvtBamRecord, typename TSvtSRBamRecord>
+  inline void
+  _evidenceSamples(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, bam_hdr_t const* hdr, TSRCache& srCache, TSampleLib& sampleLib, std::vector<TSvtBamRecord>& fileBamRecord, std::vector<TSvtSRBamRecord>& fileSRBR)
+  {
+    typedef std::vector<SRBamRecord> TSRBamRecord;
+    uint64_t regionHash = _evidenceRegionHash(hdr, scanRegions);
+
+    // Sidecars carry no read sequences, the assembly re-reads these samples
+    if (c.fusedScan) {
+      srCache.resize(c.files.size(), SplitReadCache(hdr->n_targets));
+      for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) std::fill(srCache[file_c].complete.begin(), srCache[file_c].complete.end(), 0);
+    }
+    std::vector<bool> pending(c.files.size(), true);
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) pending[file_c] = !c.controlFile[file_c];
+    for(int32_t pass = 0; pass < 2; ++pass) {
+      if (pass) {
+	if (std::find(pending.begin(), pending.end(), true) == pending.end()) break;
+	// Capture at the evidence floors so that later runs can tighten the cutoffs
+	TConfig cap(c);
+	cap.minMapQual = std::min(c.minMapQual, (uint16_t) 1);
+	cap.minTraQual = cap.minMapQual;
+	cap.madCutoff = std::min(c.madCutoff, (uint16_t) DELLY_EVIDENCE_MAD);
+	cap.minClip = std::min(c.minClip, (uint32_t) DELLY_EVIDENCE_MINCLIP);
+	cap.svtcmd = false;
+	TSampleLib capLib(sampleLib);
+	for(uint32_t file_c = 0; file_c < capLib.size(); ++file_c) {
+	  if (capLib[file_c].median) _libraryCutoffs(cap, capLib[file_c]);
+	}
+	_scanSamples(cap, validRegions, scanRegions, hdr, pending, srCache, capLib, fileBamRecord, fileSRBR);
+      }
+      boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
+      std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Loading SV evidence" << std::endl;
+      std::vector<uint8_t> loaded(c.files.size(), 0);
+#pragma omp parallel for default(shared) schedule(dynamic, 1)
+      for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+	if (!pending[file_c]) continue;
+	if (_evidenceCall(c, file_c, regionHash, hdr, sampleLib[file_c], fileBamRecord[file_c], fileSRBR[file_c])) loaded[file_c] = 1;
+	else {
+	  TSvtBamRecord(2 * DELLY_SVT_TRANS, BamAlignStore()).swap(fileBamRecord[file_c]);
+	  TSvtSRBamRecord(2 * DELLY_SVT_TRANS, TSRBamRecord()).swap(fileSRBR[file_c]);
+	  sampleLib[file_c].abnormal_pairs = 0;
+	}
+      }
+      for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+	if (loaded[file_c]) pending[file_c] = false;
+      }
+    }
+
+    // Unusable evidence directory, call directly from the alignments
+    if (std::find(pending.begin(), pending.end(), true) != pending.end()) {
+      std::cerr << "Warning: SV evidence could not be stored, scanning the alignments directly!" << std::endl;
+      TConfig direct(c);
+      direct.hasEvidence = false;
+      _scanSamples(direct, validRegions, scanRegions, hdr, pending, srCache, sampleLib, fileBamRecord, fileSRBR);
+    }
+  }
+
+      
+  template<typename TConfig, typename TValidRegion, typename TSRStore, typename TSRCache, typename TSampleLib>
+  inline void
+  scanPEandSR(TConfig const& c, TValidRegion const& validRegions, TValidRegion const& scanRegions, std::vector<StructuralVariantRecord>& svs, std::vector<StructuralVariantRecord>& srSVs, TSRStore& srStore, TSRCache& srCache, TSampleLib& sampleLib)
+  {
+    // Header
+    bam_hdr_t* hdr = _hHeader(c.files[0].string());
+
+    // Split-read records
+    typedef std::vector<SRBamRecord> TSRBamRecord;
+    typedef std::vector<TSRBamRecord> TSvtSRBamRecord;
+    TSvtSRBamRecord srBR(2 * DELLY_SVT_TRANS, TSRBamRecord());
+
+    // Create bam alignment record vector
+    typedef std::vector<BamAlignStore> TSvtBamRecord;
+    TSvtBamRecord bamRecord(2 * DELLY_SVT_TRANS, BamAlignStore());
+
+    // Scan all non-control samples or load their evidence, one buffer per sample
+    std::vector<TSvtBamRecord> fileBamRecord(c.files.size(), TSvtBamRecord(2 * DELLY_SVT_TRANS, BamAlignStore()));
+    std::vector<TSvtSRBamRecord> fileSRBR(c.files.size(), TSvtSRBamRecord(2 * DELLY_SVT_TRANS, TSRBamRecord()));
+    std::vector<bool> scanFile(c.files.size(), true);
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) scanFile[file_c] = !c.controlFile[file_c];
+    if (c.hasEvidence) _evidenceSamples(c, validRegions, scanRegions, hdr, srCache, sampleLib, fileBamRecord, fileSRBR);
+    else _scanSamples(c, validRegions, scanRegions, hdr, scanFile, srCache, sampleLib, fileBamRecord, fileSRBR);
+
+    // Concatenate sample buffers
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+      for(uint32_t svt = 0; svt < bamRecord.size(); ++svt) {
+	bamRecord[svt].append(fileBamRecord[file_c][svt]);
+	BamAlignStore().swap(fileBamRecord[file_c][svt]);
+      }
+      for(uint32_t svt = 0; svt < srBR.size(); ++svt) {
+	srBR[svt].insert(srBR[svt].end(), fileSRBR[file_c][svt].begin(), fileSRBR[file_c][svt].end());
+	TSRBamRecord().swap(fileSRBR[file_c][svt]);
       }
     }
 
@@ -440,7 +1104,7 @@ namespace torali
     //outputSRBamRecords(c, srBR);
 
     // Cluster split-read records
-    now = boost::posix_time::second_clock::local_time();
+    boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
     std::cout << '[' << boost::posix_time::to_simple_string(now) << "] " << "Split-read clustering" << std::endl;
     boost::progress_display spSR( srBR.size() );
     for(uint32_t svt = 0; svt < srBR.size(); ++svt) {
@@ -471,10 +1135,10 @@ namespace torali
       if (bamRecord[svt].empty()) continue;
 	
       // Sort BAM records according to position
-      std::sort(bamRecord[svt].begin(), bamRecord[svt].end(), SortBamRecords<BamAlignRecord>());
+      sortBamRecords(bamRecord[svt], sampleLib);
 
       // Cluster
-      cluster(c, bamRecord[svt], svs, varisize, svt);
+      cluster(c, bamRecord[svt], sampleLib, svs, varisize, svt);
     }
 
     // Track split-reads
@@ -491,11 +1155,16 @@ namespace torali
       }
     }
 
-    // Clean-up
-    bam_hdr_destroy(hdr);
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
+    // Keep only captured sequences of assigned split-reads
+    for(uint32_t file_c = 0; file_c < srCache.size(); ++file_c) {
+      for(uint32_t refIndex = 0; refIndex < srCache[file_c].reads.size(); ++refIndex) {
+	std::vector<SplitReadSeq> assigned;
+	for(uint32_t i = 0; i < srCache[file_c].reads[refIndex].size(); ++i) {
+	  SplitReadSeq const& srs = srCache[file_c].reads[refIndex][i];
+	  if (srStore[refIndex].find(std::make_pair(srs.pos, srs.seed)) != srStore[refIndex].end()) assigned.push_back(srs);
+	}
+	srCache[file_c].reads[refIndex].swap(assigned);
+      }
     }
   }
 
@@ -4,6 +4,7 @@
 #include <iostream>
 #include "gotoh.h"
 #include "needle.h"
+#include "refcache.h"
 
 namespace torali
 {
@@ -128,9 +129,9 @@ namespace torali
     if (_translocation(svt)) {
       uint8_t ct = _getSpanOrientation(svt);
       if (svRec.chr==refIndex) {
-	if ((ct==0) || (ct == 2)) return boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd)) + svRec.part1;
+	if ((ct==0) || (ct == 2)) return boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd)) + svRec.part1;
 	else if (ct == 1) {
-	  std::string strEnd=boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd));
+	  std::string strEnd=boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd));
 	  std::string refPart=strEnd;
 	  std::string::reverse_iterator itR = strEnd.rbegin();
 	  std::string::reverse_iterator itREnd = strEnd.rend();
@@ -145,11 +146,11 @@ namespace torali
 	    }
 	  }
 	  return refPart + svRec.part1;
-	} else return svRec.part1 + boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd));
+	} else return svRec.part1 + boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd));
       } else {
 	// chr2
 	if (ct==0) {
-	  std::string strEnd=boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd));
+	  std::string strEnd=boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd));
 	  std::string refPart=strEnd;
 	  std::string::reverse_iterator itR = strEnd.rbegin();
 	  std::string::reverse_iterator itREnd = strEnd.rend();
@@ -164,18 +165,18 @@ namespace torali
 	    }
 	  }
 	  return refPart;
-	} else return boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd));
+	} else return boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd));
       }
     } else {
       if (svt == 2) {
-	if (svRec.svEnd - svRec.svStart <= DELLY_CHOP_REFSIZE) return boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svEndEnd));
-	else return boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd)) + boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd));
+	if (svRec.svEnd - svRec.svStart <= DELLY_CHOP_REFSIZE) return boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svEndEnd));
+	else return boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd)) + boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd));
       } else if (svt == 4) {
-	return boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svEndEnd));
+	return boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svEndEnd));
       } else if (svt == 3) {
-	return boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd)) + boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd));
+	return boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd)) + boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd));
       } else if (svt == 0) {
-	std::string strEnd=boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd));
+	std::string strEnd=boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd));
 	std::string strRevComp=strEnd;
 	std::string::reverse_iterator itR = strEnd.rbegin();
 	std::string::reverse_iterator itREnd = strEnd.rend();
@@ -189,9 +190,9 @@ namespace torali
 	  default: break;
 	  }
 	}
-	return boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd)) + strRevComp;
+	return boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd)) + strRevComp;
       } else if (svt == 1) {
-	std::string strStart=boost::to_upper_copy(std::string(ref + svRec.svStartBeg, ref + svRec.svStartEnd));
+	std::string strStart=boost::to_upper_copy(_refString(ref, svRec.svStartBeg, svRec.svStartEnd));
 	std::string strRevComp=strStart;
 	std::string::reverse_iterator itR = strStart.rbegin();
 	std::string::reverse_iterator itREnd = strStart.rend();
@@ -205,7 +206,7 @@ namespace torali
 	  default: break;
 	  }
 	}
-	return strRevComp + boost::to_upper_copy(std::string(ref + svRec.svEndBeg, ref + svRec.svEndEnd));
+	return strRevComp + boost::to_upper_copy(_refString(ref, svRec.svEndBeg, svRec.svEndEnd));
       }
     }
     return "";
@@ -429,7 +430,7 @@ namespace torali
 
   template<typename TConfig>
   inline bool
-  alignConsensus(TConfig const& c, bam_hdr_t* hdr, char const* seq, char const* sndSeq, StructuralVariantRecord& sv) {
+  alignConsensus(TConfig const& c, bam_hdr_t* hdr, RefView const* seq, RefView const* sndSeq, StructuralVariantRecord& sv) {
     if ( (int32_t) sv.consensus.size() < (2 * c.minimumFlankSize + sv.insLen)) return false;
     
     // Get reference slice
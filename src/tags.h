@@ -1,6 +1,8 @@
 #ifndef TAGS_H
 #define TAGS_H
 
+#include "hash.h"
+
 namespace torali {
 
   #ifndef DELLY_SVT_TRANS
@@ -35,6 +37,12 @@ namespace torali {
     }
   }
 
+  // SV type as a compile-time constant, kernels instantiated per SV type have no SV type branches
+  template<int32_t TSvt>
+  struct SvtPolicy {
+    enum { svt = TSvt, translocation = (DELLY_SVT_TRANS <= TSvt), ct = ((DELLY_SVT_TRANS <= TSvt) ? (TSvt - DELLY_SVT_TRANS) : TSvt) };
+  };
+
   // Structural variant record
   struct StructuralVariantRecord {
     int32_t chr;
@@ -118,17 +126,17 @@ namespace torali {
     }
   }
   
-  template<typename TPos>
+  template<int32_t TSvt, typename TPos>
   inline TPos
-  _minCoord(TPos const position, TPos const matePosition, int32_t const svt) {
-    if (_translocation(svt)) return position;
+  _minCoord(TPos const position, TPos const matePosition) {
+    if (SvtPolicy<TSvt>::translocation) return position;
     else return std::min(position, matePosition);
   }
 
-  template<typename TPos>
+  template<int32_t TSvt, typename TPos>
   inline TPos
-  _maxCoord(TPos const position, TPos const matePosition, int32_t const svt) {
-    if (_translocation(svt)) return matePosition;
+  _maxCoord(TPos const position, TPos const matePosition) {
+    if (SvtPolicy<TSvt>::translocation) return matePosition;
     else return std::max(position, matePosition);
   }
 
@@ -214,15 +222,6 @@ namespace torali {
     } 
   }
 
-  inline unsigned hash_string(const char *s) {
-    unsigned h = 37;
-    while (*s) {
-      h = (h * 54059) ^ (s[0] * 76963);
-      s++;
-    }
-    return h;
-  }
-  
   template<typename TAlignedReads>
   inline bool
   _firstPairObs(bam1_t* rec, TAlignedReads const& lastAlignedPosReads) {
@@ -231,11 +230,11 @@ namespace torali {
   }
 
   // Deletions
-  template<typename TSize, typename TISize>
+  template<int32_t TSvt, typename TSize, typename TISize>
   inline bool
-  _pairsDisagree(TSize const pair1Min, TSize const pair1Max, TSize const pair1ReadLength, TISize const pair1maxNormalISize, TSize const pair2Min, TSize const pair2Max, TSize const pair2ReadLength, TISize const pair2maxNormalISize, int32_t const svt) {
-    if (_translocation(svt)) {
-      uint8_t ct = _getSpanOrientation(svt);
+  _pairsDisagree(TSize const pair1Min, TSize const pair1Max, TSize const pair1ReadLength, TISize const pair1maxNormalISize, TSize const pair2Min, TSize const pair2Max, TSize const pair2ReadLength, TISize const pair2maxNormalISize) {
+    if (SvtPolicy<TSvt>::translocation) {
+      int32_t const ct = SvtPolicy<TSvt>::ct;
 
       // Check read offsets
       if (ct%2==0) {
@@ -271,9 +270,9 @@ namespace torali {
       }
       return false;
     } else {
-      if (svt < 2) {
+      if (TSvt < 2) {
 	// Inversion
-	if (!svt) {
+	if (!TSvt) {
 	  // Left-spanning inversions
 	  if ((pair2Min + pair2ReadLength - pair1Min) > pair1maxNormalISize) return true;
 	  if ((pair2Max < pair1Max) && ((pair1Max + pair1ReadLength - pair2Max) > pair2maxNormalISize)) return true;
@@ -285,14 +284,14 @@ namespace torali {
 	  if ((pair2Max >= pair1Max) && ((pair2Max + pair2ReadLength - pair1Max) > pair2maxNormalISize)) return true;
 	}
 	return false;
-      } else if (svt == 2) {
+      } else if (TSvt == 2) {
 	// Deletion
 	if ((pair2Min + pair2ReadLength - pair1Min) > pair1maxNormalISize) return true;
 	if ((pair2Max < pair1Max) && ((pair1Max + pair1ReadLength - pair2Max) > pair1maxNormalISize)) return true;
 	if ((pair2Max >= pair1Max) && ((pair2Max + pair2ReadLength - pair1Max) > pair2maxNormalISize)) return true;
 	if ((pair1Max < pair2Min) || (pair2Max < pair1Min)) return true;
 	return false;
-      } else if (svt == 3) {
+      } else if (TSvt == 3) {
 	if ((pair2Min + pair2ReadLength - pair1Min) > pair2maxNormalISize) return true;
 	if ((pair2Max < pair1Max) && ((pair1Max + pair1ReadLength - pair2Max) > pair2maxNormalISize)) return true;
 	if ((pair2Max >= pair1Max) && ((pair2Max + pair2ReadLength - pair1Max) > pair1maxNormalISize)) return true;
@@ -91,9 +91,8 @@ namespace torali {
    typedef std::vector<StructuralVariantRecord> TVariants;
    TVariants svs;
 
-   // Open header
-   samFile* samfile = sam_open(c.files[0].string().c_str(), "r");
-   bam_hdr_t* hdr = sam_hdr_read(samfile);
+   // Header
+   bam_hdr_t* hdr = _hHeader(c.files[0].string());
 
    // Exclude intervals
    typedef boost::icl::interval_set<uint32_t> TChrIntervals;
@@ -101,8 +100,6 @@ namespace torali {
    TRegionsGenome validRegions;
    if (!_parseExcludeIntervals(c, hdr, validRegions)) {
      std::cerr << "Delly couldn't parse exclude intervals!" << std::endl;
-     bam_hdr_destroy(hdr);
-     sam_close(samfile);
      return 1;
    }
      
@@ -138,9 +135,6 @@ namespace torali {
        svs.push_back(*svIter);
      }
    } else vcfParse(c, hdr, svs);   // Re-genotyping
-   // Clean-up
-   bam_hdr_destroy(hdr);
-   sam_close(samfile);
 
    // Re-number SVs
    sort(svs.begin(), svs.end(), SortSVs<StructuralVariantRecord>());
@@ -233,9 +227,15 @@ namespace torali {
    std::string svtype;
    std::string scoring;
    std::string mode;
+   int32_t ioThreads = 0;
+   int32_t maxOpen = 0;
+   int32_t prefetch = 0;
    boost::program_options::options_description generic("Generic options");
    generic.add_options()
      ("help,?", "show help message")
+     ("io-threads", boost::program_options::value<int32_t>(&ioThreads)->default_value(0), "htslib I/O threads shared by all files")
+     ("prefetch", boost::program_options::value<int32_t>(&prefetch)->default_value(4), "record batches decoded ahead of each scan (0: off)")
+     ("max-open", boost::program_options::value<int32_t>(&maxOpen)->default_value(DELLY_MAX_OPEN), "max. open alignment files, idle files beyond are closed")
      ("svtype,t", boost::program_options::value<std::string>(&svtype)->default_value("ALL"), "SV type to compute [DEL, INS, DUP, INV, BND, ALL]")
      ("technology,y", boost::program_options::value<std::string>(&mode)->default_value("ont"), "seq. technology [pb, ont]")
      ("genome,g", boost::program_options::value<boost::filesystem::path>(&c.genome), "genome fasta file")
@@ -306,62 +306,23 @@ namespace torali {
      std::cerr << "Reference file is missing: " << c.genome.string() << std::endl;
      return 1;
    } else {
-     faidx_t* fai = fai_load(c.genome.string().c_str());
+     faidx_t* fai = _hFaiOpen(c.genome.string());
      if (fai == NULL) {
        if (fai_build(c.genome.string().c_str()) == -1) {
 	 std::cerr << "Fail to open genome fai index for " << c.genome.string() << std::endl;
 	 return 1;
-       } else fai = fai_load(c.genome.string().c_str());
+       } else fai = _hFaiOpen(c.genome.string());
      }
-     fai_destroy(fai);
+     _hFaiClose(fai);
    }
+
+   // Shared I/O thread pool and alignment handles
+   _ioPoolInit(ioThreads);
+   _ioPrefetchInit(prefetch);
+   _hPoolInit(maxOpen);
    
    // Check input files
-   c.sampleName.resize(c.files.size());
-   c.nchr = 0;
-   for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-     if (!(boost::filesystem::exists(c.files[file_c]) && boost::filesystem::is_regular_file(c.files[file_c]) && boost::filesystem::file_size(c.files[file_c]))) {
-       std::cerr << "Alignment file is missing: " << c.files[file_c].string() << std::endl;
-       return 1;
-     }
-     samFile* samfile = sam_open(c.files[file_c].string().c_str(), "r");
-     if (samfile == NULL) {
-       std::cerr << "Fail to open file " << c.files[file_c].string() << std::endl;
-       return 1;
-     }
-     hts_idx_t* idx = sam_index_load(samfile, c.files[file_c].string().c_str());
-     if (idx == NULL) {
-       std::cerr << "Fail to open index for " << c.files[file_c].string() << std::endl;
-       return 1;
-     }
-     bam_hdr_t* hdr = sam_hdr_read(samfile);
-     if (hdr == NULL) {
-       std::cerr << "Fail to open header for " << c.files[file_c].string() << std::endl;
-       return 1;
-     }
-     if (!c.nchr) c.nchr = hdr->n_targets;
-     else {
-       if (c.nchr != hdr->n_targets) {
-	 std::cerr << "BAM files have different number of chromosomes!" << std::endl;
-	 return 1;
-       }
-     }
-     faidx_t* fai = fai_load(c.genome.string().c_str());
-     for(int32_t refIndex=0; refIndex < hdr->n_targets; ++refIndex) {
-       std::string tname(hdr->target_name[refIndex]);
-       if (!faidx_has_seq(fai, tname.c_str())) {
-	 std::cerr << "BAM file chromosome " << hdr->target_name[refIndex] << " is NOT present in your reference file " << c.genome.string() << std::endl;
-	 return 1;
-       }
-     }
-     fai_destroy(fai);
-     std::string sampleName = "unknown";
-     getSMTag(std::string(hdr->text), c.files[file_c].stem().string(), sampleName);
-     c.sampleName[file_c] = sampleName;
-     bam_hdr_destroy(hdr);
-     hts_idx_destroy(idx);
-     sam_close(samfile);
-   }
+   if (checkAlignmentFiles(c)) return 1;
 
    // Check exclude file
    if (vm.count("exclude")) {
@@ -378,7 +339,7 @@ namespace torali {
        std::cerr << "Input VCF/BCF file is missing: " << c.vcffile.string() << std::endl;
        return 1;
      }
-     htsFile* ifile = bcf_open(c.vcffile.string().c_str(), "r");
+     htsFile* ifile = _ioAttach(bcf_open(c.vcffile.string().c_str(), "r"));
      if (ifile == NULL) {
        std::cerr << "Fail to open file " << c.vcffile.string() << std::endl;
        return 1;
@@ -7,10 +7,20 @@
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
+#include <boost/icl/interval_set.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/tokenizer.hpp>
+#include <boost/lexical_cast.hpp>
 #include <htslib/sam.h>
+#include <fstream>
 #include <sstream>
 #include <math.h>
 #include "tags.h"
+#include "matetable.h"
+#include "iopool.h"
+#include "handles.h"
+#include "prefetch.h"
+#include "refcache.h"
 
 
 namespace torali
@@ -19,6 +29,10 @@ namespace torali
   #ifndef LAST_BIN
   #define LAST_BIN 65535
   #endif
+
+  #ifndef DELLY_REGION_GAP
+  #define DELLY_REGION_GAP 10000
+  #endif
   
   struct LibraryInfo {
     int32_t rs;
@@ -217,6 +231,23 @@ namespace torali
     return alen;
   }
 
+  // Alignment length of the mate from the MC tag, the read's own alignment length if the tag is missing
+  inline uint32_t mateAlignmentLength(bam1_t const* rec) {
+    uint8_t* mcptr = bam_aux_get(rec, "MC");
+    if (mcptr == NULL) return alignmentLength(rec);
+    char const* cg = bam_aux2Z(mcptr);
+    if (cg == NULL) return alignmentLength(rec);
+    uint32_t alen = 0;
+    while ((*cg >= '0') && (*cg <= '9')) {
+      char* endptr = NULL;
+      uint32_t oplen = strtoul(cg, &endptr, 10);
+      if ((*endptr == 'M') || (*endptr == '=') || (*endptr == 'X') || (*endptr == 'D') || (*endptr == 'N')) alen += oplen;
+      if (*endptr == '\0') break;
+      cg = endptr + 1;
+    }
+    return alen;
+  }
+
   inline uint32_t halfAlignmentLength(bam1_t const* rec) {
     return (alignmentLength(rec) / 2);
   }
@@ -229,30 +260,20 @@ namespace torali
 
 
   inline std::size_t hash_lr(bam1_t* rec) {
-    boost::hash<std::string> string_hash;
-    std::string qname = bam_get_qname(rec);
-    std::size_t seed = hash_string(qname.c_str());
-    boost::hash_combine(seed, string_hash(qname));
-    return seed;
+    return hash_string(bam_get_qname(rec));
   }
       
   
   inline std::size_t hash_pair(bam1_t* rec) {
-    std::size_t seed = hash_string(bam_get_qname(rec));
-    boost::hash_combine(seed, rec->core.tid);
-    boost::hash_combine(seed, rec->core.pos);
-    boost::hash_combine(seed, rec->core.mtid);
-    boost::hash_combine(seed, rec->core.mpos);
-    return seed;
+    uint64_t seed = hash_string(bam_get_qname(rec));
+    seed = hash_mix(seed, hash_pos(rec->core.tid, rec->core.pos));
+    return hash_mix(seed, hash_pos(rec->core.mtid, rec->core.mpos));
   }
 
   inline std::size_t hash_pair_mate(bam1_t* rec) {
-    std::size_t seed = hash_string(bam_get_qname(rec));
-    boost::hash_combine(seed, rec->core.mtid);
-    boost::hash_combine(seed, rec->core.mpos);
-    boost::hash_combine(seed, rec->core.tid);
-    boost::hash_combine(seed, rec->core.pos);
-    return seed;
+    uint64_t seed = hash_string(bam_get_qname(rec));
+    seed = hash_mix(seed, hash_pos(rec->core.mtid, rec->core.mpos));
+    return hash_mix(seed, hash_pos(rec->core.tid, rec->core.pos));
   }
 
   inline void
@@ -345,10 +366,7 @@ namespace torali
   }    
   
   inline std::size_t hash_se(bam1_t* rec) {
-    std::size_t seed = hash_string(bam_get_qname(rec));
-    boost::hash_combine(seed, rec->core.tid);
-    boost::hash_combine(seed, rec->core.pos);
-    return seed;
+    return hash_mix(hash_string(bam_get_qname(rec)), hash_pos(rec->core.tid, rec->core.pos));
   }
   
   inline void
@@ -391,6 +409,104 @@ namespace torali
     }
   }
 
+  // Checksum of the reference sequence dictionary of a header
+  inline uint64_t
+  _headerChecksum(bam_hdr_t const* hdr) {
+    uint64_t h = hash_mix(0, hdr->n_targets);
+    for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+      h = hash_mix(h, hash_string(hdr->target_name[refIndex]));
+      h = hash_mix(h, hdr->target_len[refIndex]);
+    }
+    return h;
+  }
+
+  // Check alignment files, index, header and reference contigs in parallel, contig checks are cached by header checksum
+  template<typename TConfig>
+  inline int32_t
+  checkAlignmentFiles(TConfig& c) {
+    c.sampleName.resize(c.files.size());
+    c.nchr = 0;
+    faidx_t* fai = _hFaiOpen(c.genome.string());
+    if (fai == NULL) {
+      std::cerr << "Fail to open genome fai index for " << c.genome.string() << std::endl;
+      return 1;
+    }
+    std::vector<std::string> errMsg(c.files.size());
+    std::vector<int32_t> nchr(c.files.size(), 0);
+    typedef std::map<uint64_t, std::string> TContigCache;
+    TContigCache contigCache;
+#pragma omp parallel for schedule(dynamic)
+    for(int32_t file_c = 0; file_c < (int32_t) c.files.size(); ++file_c) {
+      std::string const file = c.files[file_c].string();
+      if (!(boost::filesystem::exists(c.files[file_c]) && boost::filesystem::is_regular_file(c.files[file_c]) && boost::filesystem::file_size(c.files[file_c]))) {
+	errMsg[file_c] = "Alignment file is missing: " + file;
+	continue;
+      }
+      samFile* samfile = _hOpen(file, c.genome.string(), 0);
+      if (samfile == NULL) {
+	errMsg[file_c] = "Fail to open file " + file;
+	continue;
+      }
+      hts_idx_t* idx = _hIndex(samfile);
+      _hClose(samfile);
+      if (idx == NULL) {
+	errMsg[file_c] = "Fail to open index for " + file;
+	continue;
+      }
+      bam_hdr_t* hdr = _hHeader(file);
+      if (hdr == NULL) {
+	errMsg[file_c] = "Fail to open header for " + file;
+	continue;
+      }
+      nchr[file_c] = hdr->n_targets;
+
+      // Cohorts share a few sequence dictionaries, check each one once
+      uint64_t checksum = _headerChecksum(hdr);
+      bool cached = false;
+      std::string missing;
+#pragma omp critical (contigcache)
+      {
+	TContigCache::const_iterator it = contigCache.find(checksum);
+	if (it != contigCache.end()) {
+	  cached = true;
+	  missing = it->second;
+	}
+      }
+      if (!cached) {
+	for(int32_t refIndex=0; refIndex < hdr->n_targets; ++refIndex) {
+	  if (!faidx_has_seq(fai, hdr->target_name[refIndex])) {
+	    missing = hdr->target_name[refIndex];
+	    break;
+	  }
+	}
+#pragma omp critical (contigcache)
+	contigCache[checksum] = missing;
+      }
+      if (!missing.empty()) {
+	errMsg[file_c] = "BAM file chromosome " + missing + " is NOT present in your reference file " + c.genome.string();
+	continue;
+      }
+      std::string sampleName = "unknown";
+      getSMTag(std::string(hdr->text), c.files[file_c].stem().string(), sampleName);
+      c.sampleName[file_c] = sampleName;
+    }
+    _hFaiClose(fai);
+
+    // Report in input order
+    for(uint32_t file_c = 0; file_c < c.files.size(); ++file_c) {
+      if (!errMsg[file_c].empty()) {
+	std::cerr << errMsg[file_c] << std::endl;
+	return 1;
+      }
+      if (!c.nchr) c.nchr = nchr[file_c];
+      else if (c.nchr != nchr[file_c]) {
+	std::cerr << "BAM files have different number of chromosomes!" << std::endl;
+	return 1;
+      }
+    }
+    return 0;
+  }
+
   template<typename TConfig, typename TRegionsGenome>
   inline int32_t
   _parseExcludeIntervals(TConfig const& c, bam_hdr_t* hdr, TRegionsGenome& validRegions) {
@@ -467,6 +583,184 @@ namespace torali
     return true;
   }
 
+  // Parse a samtools-style region chr[:start-end] (1-based, inclusive) into a 0-based, half-open interval
+  inline bool
+  _parseRegionString(bam_hdr_t* hdr, std::string const& region, int32_t& tid, int32_t& start, int32_t& end) {
+    std::string chrName = region;
+    start = 0;
+    end = -1;
+    std::size_t colon = region.find_last_of(':');
+    if (colon != std::string::npos) {
+      chrName = region.substr(0, colon);
+      std::string range = region.substr(colon + 1);
+      range.erase(std::remove(range.begin(), range.end(), ','), range.end());
+      std::size_t dash = range.find('-');
+      try {
+	start = boost::lexical_cast<int32_t>(range.substr(0, dash)) - 1;
+	if ((dash != std::string::npos) && (dash + 1 < range.size())) end = boost::lexical_cast<int32_t>(range.substr(dash + 1));
+      } catch (boost::bad_lexical_cast&) {
+	// Chromosome names may contain colons
+	chrName = region;
+	start = 0;
+	end = -1;
+      }
+    }
+    tid = bam_name2id(hdr, chrName.c_str());
+    if (tid < 0) return false;
+    if ((end < 0) || (end > (int32_t) hdr->target_len[tid])) end = hdr->target_len[tid];
+    if (start < 0) start = 0;
+    return (start < end);
+  }
+
+  // Shard regions of a region-restricted run: chr:start-end or a BED file of shards (all or the c.shard-th line)
+  template<typename TConfig, typename TRegionsGenome>
+  inline bool
+  _parseShardRegions(TConfig const& c, bam_hdr_t* hdr, TRegionsGenome& shardRegions) {
+    typedef typename TRegionsGenome::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
+
+    shardRegions.clear();
+    shardRegions.resize(hdr->n_targets);
+    if (!boost::filesystem::exists(c.region)) {
+      int32_t tid = -1;
+      int32_t start = 0;
+      int32_t end = 0;
+      if (!_parseRegionString(hdr, c.region, tid, start, end)) {
+	std::cerr << "Invalid region: " << c.region << std::endl;
+	return false;
+      }
+      shardRegions[tid].insert(TIVal::right_open(start, end));
+      return true;
+    }
+    std::ifstream bedFile(c.region.c_str(), std::ifstream::in);
+    if (!bedFile.is_open()) {
+      std::cerr << "Fail to open shard file " << c.region << std::endl;
+      return false;
+    }
+    uint32_t lineCount = 0;
+    bool found = false;
+    std::string line;
+    while (std::getline(bedFile, line)) {
+      typedef boost::tokenizer< boost::char_separator<char> > Tokenizer;
+      boost::char_separator<char> sep(" \t,;");
+      Tokenizer tokens(line, sep);
+      Tokenizer::iterator tokIter = tokens.begin();
+      if ((tokIter == tokens.end()) || (tokIter->at(0) == '#') || (*tokIter == "track") || (*tokIter == "browser")) continue;
+      ++lineCount;
+      if ((c.shard) && (c.shard != lineCount)) continue;
+      std::string chrName = *tokIter++;
+      int32_t tid = bam_name2id(hdr, chrName.c_str());
+      if (tid < 0) {
+	std::cerr << "Shard chromosome is not present in the BAM header: " << chrName << std::endl;
+	return false;
+      }
+      int32_t start = 0;
+      int32_t end = hdr->target_len[tid];
+      try {
+	if (tokIter != tokens.end()) start = boost::lexical_cast<int32_t>(*tokIter++);
+	if (tokIter != tokens.end()) end = std::min(boost::lexical_cast<int32_t>(*tokIter++), (int32_t) hdr->target_len[tid]);
+      } catch (boost::bad_lexical_cast&) {
+	std::cerr << "Shard file needs to be in tab-delimited format: chr, start, end" << std::endl;
+	std::cerr << "Offending line: " << line << std::endl;
+	return false;
+      }
+      if ((start < 0) || (start >= end)) {
+	std::cerr << "Shard file needs to be in tab-delimited format (chr, start, end) and start < end." << std::endl;
+	std::cerr << "Offending line: " << line << std::endl;
+	return false;
+      }
+      shardRegions[tid].insert(TIVal::right_open(start, end));
+      found = true;
+    }
+    bedFile.close();
+    if (!found) {
+      if (c.shard) std::cerr << "Shard " << c.shard << " is not present in " << c.region << " (" << lineCount << " shards)" << std::endl;
+      else std::cerr << "Shard file has no regions: " << c.region << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Restrict the valid regions to the shards extended by the overlap margin
+  template<typename TConfig, typename TRegionsGenome>
+  inline void
+  _restrictToShards(TConfig const& c, bam_hdr_t* hdr, TRegionsGenome const& shardRegions, TRegionsGenome& validRegions) {
+    typedef typename TRegionsGenome::value_type TChrIntervals;
+    typedef typename TChrIntervals::interval_type TIVal;
+
+    for(int32_t refIndex = 0; refIndex < hdr->n_targets; ++refIndex) {
+      TChrIntervals margin;
+      for(typename TChrIntervals::const_iterator it = shardRegions[refIndex].begin(); it != shardRegions[refIndex].end(); ++it) {
+	uint32_t mstart = (it->lower() > (uint32_t) c.shardMargin) ? it->lower() - c.shardMargin : 0;
+	uint32_t mend = std::min(it->upper() + (uint32_t) c.shardMargin, hdr->target_len[refIndex]);
+	margin.insert(TIVal::right_open(mstart, mend));
+      }
+      validRegions[refIndex] &= margin;
+    }
+  }
+
+  // Keep the SVs owned by the shards, i.e. SVs that start in a shard
+  template<typename TRegionsGenome, typename TSVs>
+  inline void
+  _selectShardSVs(TRegionsGenome const& shardRegions, TSVs& svs) {
+    TSVs owned;
+    for(typename TSVs::const_iterator itSV = svs.begin(); itSV != svs.end(); ++itSV) {
+      if ((itSV->chr < 0) || (itSV->chr >= (int32_t) shardRegions.size()) || (itSV->svStart < 0)) continue;
+      if (boost::icl::contains(shardRegions[itSV->chr], (uint32_t) itSV->svStart)) owned.push_back(*itSV);
+    }
+    svs.swap(owned);
+  }
+
+  // Single multi-region iterator over the valid intervals within [beg, end), nearby intervals share one region
+  template<typename TChrIntervals>
+  inline hts_itr_t*
+  _validRegionsIter(hts_idx_t const* idx, bam_hdr_t const* hdr, int32_t const refIndex, TChrIntervals const& chrIntervals, int32_t const beg, int32_t const end) {
+    std::vector<hts_pair_pos_t> ivals;
+    for(typename TChrIntervals::const_iterator vRIt = chrIntervals.begin(); vRIt != chrIntervals.end(); ++vRIt) {
+      int32_t istart = std::max((int32_t) vRIt->lower(), beg);
+      int32_t iend = std::min((int32_t) vRIt->upper(), end);
+      if (istart >= iend) continue;
+      if ((!ivals.empty()) && (istart - ivals.back().end < DELLY_REGION_GAP)) ivals.back().end = iend;
+      else {
+	hts_pair_pos_t ival;
+	ival.beg = istart;
+	ival.end = iend;
+	ivals.push_back(ival);
+      }
+    }
+    if (ivals.empty()) return NULL;
+
+    // The iterator takes ownership of the region list
+    hts_reglist_t* reglist = (hts_reglist_t*) calloc(1, sizeof(hts_reglist_t));
+    reglist->intervals = (hts_pair_pos_t*) malloc(ivals.size() * sizeof(hts_pair_pos_t));
+    std::copy(ivals.begin(), ivals.end(), reglist->intervals);
+    reglist->reg = hdr->target_name[refIndex];
+    reglist->tid = refIndex;
+    reglist->count = ivals.size();
+    reglist->min_beg = ivals.front().beg;
+    reglist->max_end = ivals.back().end;
+    return sam_itr_regions(idx, const_cast<bam_hdr_t*>(hdr), reglist, 1);
+  }
+
+  // Valid-interval filter for position-sorted reads of one chromosome
+  template<typename TChrIntervals>
+  struct ValidRegionCursor {
+    typedef typename TChrIntervals::const_iterator TIter;
+    TIter it;
+    TIter itEnd;
+
+    explicit ValidRegionCursor(TChrIntervals const& chrIntervals) : it(chrIntervals.begin()), itEnd(chrIntervals.end()) {}
+
+    // First valid base of the read, -1 if the read does not overlap a valid interval
+    inline int32_t
+    anchor(bam1_t const* rec) {
+      int32_t pos = rec->core.pos;
+      while ((it != itEnd) && ((int32_t) it->upper() <= pos)) ++it;
+      if ((it == itEnd) || ((int32_t) it->lower() >= std::max((int32_t) bam_endpos(rec), pos + 1))) return -1;
+      return std::max(pos, (int32_t) it->lower());
+    }
+  };
+
   template<typename TIterator, typename TValue>
   inline void
   getMedian(TIterator begin, TIterator end, TValue& median) 
@@ -526,6 +820,23 @@ namespace torali
     stdDev = sqrt(stdDev / (TValue) count);
   }
 
+  // Insert size cutoffs from the library median and MAD
+  template<typename TConfig>
+  inline void
+  _libraryCutoffs(TConfig const& c, LibraryInfo& lib) {
+    lib.maxNormalISize = lib.median + (c.madNormalCutoff * lib.mad);
+    lib.minNormalISize = lib.median - (c.madNormalCutoff * lib.mad);
+    if (lib.minNormalISize < 0) lib.minNormalISize=0;
+    lib.maxISizeCutoff = lib.median + (c.madCutoff * lib.mad);
+    lib.minISizeCutoff = lib.median - (c.madCutoff * lib.mad);
+
+    // Deletion insert-size sanity checks
+    lib.maxISizeCutoff = std::max(lib.maxISizeCutoff, 2*lib.rs);
+    lib.maxISizeCutoff = std::max(lib.maxISizeCutoff, 500);
+
+    if (lib.minISizeCutoff < 0) lib.minISizeCutoff=0;
+  }
+
   template<typename TConfig, typename TValidRegion, typename TSampleLibrary>
   inline void
   getLibraryParams(TConfig const& c, TValidRegion const& validRegions, TSampleLibrary& sampleLib) {
@@ -539,10 +850,9 @@ namespace torali
     TIndex idx(c.files.size());
     TSamHeader hdr(c.files.size());
     for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      samfile[file_c] = sam_open(c.files[file_c].string().c_str(), "r");
-      hts_set_fai_filename(samfile[file_c], c.genome.string().c_str());
-      idx[file_c] = sam_index_load(samfile[file_c], c.files[file_c].string().c_str());
-      hdr[file_c] = sam_hdr_read(samfile[file_c]);
+      samfile[file_c] = _hOpen(c.files[file_c].string(), c.genome.string(), DELLY_CRAM_INSERT);
+      idx[file_c] = _hIndex(samfile[file_c]);
+      hdr[file_c] = _hHeader(c.files[file_c].string());
     }
 
     // Iterate all samples
@@ -563,40 +873,42 @@ namespace torali
       bool libCharacterized = false;
       for(uint32_t refIndex=0; refIndex < (uint32_t) hdr[0]->n_targets; ++refIndex) {
 	if (validRegions[refIndex].empty()) continue;
-	for(typename TChrIntervals::const_iterator vRIt = validRegions[refIndex].begin(); ((vRIt != validRegions[refIndex].end()) && (!libCharacterized)); ++vRIt) {
-	  hts_itr_t* iter = sam_itr_queryi(idx[file_c], refIndex, vRIt->lower(), vRIt->upper());
-	  bam1_t* rec = bam_init1();
-	  while (sam_itr_next(samfile[file_c], iter, rec) >= 0) {
-	    if (!(rec->core.flag & BAM_FREAD2) && (rec->core.l_qseq < 65000)) {
-	      if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP)) continue;
-	      if ((alignmentCount > maxAlignmentsScreened) || ((processedNumReads >= maxNumAlignments) && (processedNumPairs == 0)) || (processedNumPairs >= maxNumAlignments)) {
-		  // Paired-end library with enough pairs
-		  libCharacterized = true;
-		  break;
-	      }
-	      ++alignmentCount;
+	hts_itr_t* iter = _validRegionsIter(idx[file_c], hdr[file_c], refIndex, validRegions[refIndex], 0, hdr[file_c]->target_len[refIndex]);
+	if (iter == NULL) continue;
+	ValidRegionCursor<TChrIntervals> cursor(validRegions[refIndex]);
+	bam1_t* rec = bam_init1();
+	while (_ioItrNext(samfile[file_c], iter, rec) >= 0) {
+	  if (cursor.anchor(rec) < 0) continue;
+	  // Read length from the CIGAR, sequences are not decoded
+	  int32_t slen = sequenceLength(rec);
+	  if (!(rec->core.flag & BAM_FREAD2) && (slen < 65000)) {
+	    if (rec->core.flag & (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP)) continue;
+	    if ((alignmentCount > maxAlignmentsScreened) || ((processedNumReads >= maxNumAlignments) && (processedNumPairs == 0)) || (processedNumPairs >= maxNumAlignments)) {
+		// Paired-end library with enough pairs
+		libCharacterized = true;
+		break;
+	    }
+	    ++alignmentCount;
 	      
-	      // Single-end
-	      if (processedNumReads < maxNumAlignments) {
-		readSize.push_back(rec->core.l_qseq);
-		++processedNumReads;
-	      }
+	    // Single-end
+	    if (processedNumReads < maxNumAlignments) {
+	      readSize.push_back(slen);
+	      ++processedNumReads;
+	    }
 	      
-	      // Paired-end
-	      if ((rec->core.flag & BAM_FPAIRED) && !(rec->core.flag & BAM_FMUNMAP) && (rec->core.tid==rec->core.mtid)) {
-		if (processedNumPairs < maxNumAlignments) {
-		  vecISize.push_back(abs(rec->core.isize));
-		  if (getSVType(rec->core) == 2) ++rplus;
-		  else ++nonrplus;
-		  ++processedNumPairs;
-		}
+	    // Paired-end
+	    if ((rec->core.flag & BAM_FPAIRED) && !(rec->core.flag & BAM_FMUNMAP) && (rec->core.tid==rec->core.mtid)) {
+	      if (processedNumPairs < maxNumAlignments) {
+		vecISize.push_back(abs(rec->core.isize));
+		if (getSVType(rec->core) == 2) ++rplus;
+		else ++nonrplus;
+		++processedNumPairs;
 	      }
 	    }
 	  }
-	  bam_destroy1(rec);
-	  hts_itr_destroy(iter);
-	  if (libCharacterized) break;
 	}
+	bam_destroy1(rec);
+	hts_itr_destroy(iter);
 	if (libCharacterized) break;
       }
     
@@ -622,28 +934,14 @@ namespace torali
 	  } else {
 	    sampleLib[file_c].median = median;
 	    sampleLib[file_c].mad = mad;
-	    sampleLib[file_c].maxNormalISize = median + (c.madNormalCutoff * mad);
-	    sampleLib[file_c].minNormalISize = median - (c.madNormalCutoff * mad);
-	    if (sampleLib[file_c].minNormalISize < 0) sampleLib[file_c].minNormalISize=0;
-	    sampleLib[file_c].maxISizeCutoff = median + (c.madCutoff * mad);
-	    sampleLib[file_c].minISizeCutoff = median - (c.madCutoff * mad);
-
-	    // Deletion insert-size sanity checks
-	    sampleLib[file_c].maxISizeCutoff = std::max(sampleLib[file_c].maxISizeCutoff, 2*sampleLib[file_c].rs);
-	    sampleLib[file_c].maxISizeCutoff = std::max(sampleLib[file_c].maxISizeCutoff, 500);
-
-	    if (sampleLib[file_c].minISizeCutoff < 0) sampleLib[file_c].minISizeCutoff=0;
+	    _libraryCutoffs(c, sampleLib[file_c]);
 	  }
 	}
       }
     }
 
     // Clean-up
-    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) {
-      bam_hdr_destroy(hdr[file_c]);
-      hts_idx_destroy(idx[file_c]);
-      sam_close(samfile[file_c]);
-    }
+    for(unsigned int file_c = 0; file_c < c.files.size(); ++file_c) _hClose(samfile[file_c]);
   }
 
 